@@ -0,0 +1,125 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Time the plain text of a package taken with TextExtractor against
+  Document::open() and extract_text(), on the same file.
+
+  duckx_bench_text [package.odt [passes]]
+
+  Without a package, one with many paragraphs of styled text is written
+  to duckx_bench_text.odt first.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "duckx.hpp"
+
+static const char generated[] = "duckx_bench_text.odt";
+
+static bool write_entry(zip_t *zip, const char *name,
+                        const std::string &data) {
+    bool ok = zip_entry_open(zip, name) == 0 &&
+              zip_entry_write(zip, data.data(), data.size()) == 0;
+    return zip_entry_close(zip) == 0 && ok;
+}
+
+// content.xml of about 10 MB: paragraphs of spans, spaces and tabs, lists
+// and tables, as written by office suites
+static bool write_package(const char *path) {
+    std::string content =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?><office:document-content "
+        "xmlns:office=\"urn:oasis:names:tc:opendocument:xmlns:office:1.0\" "
+        "xmlns:style=\"urn:oasis:names:tc:opendocument:xmlns:style:1.0\" "
+        "xmlns:text=\"urn:oasis:names:tc:opendocument:xmlns:text:1.0\" "
+        "xmlns:table=\"urn:oasis:names:tc:opendocument:xmlns:table:1.0\" "
+        "office:version=\"1.2\"><office:automatic-styles/><office:body>"
+        "<office:text>";
+    for (int i = 0; i < 40000; i++) {
+        content += "<text:p text:style-name=\"P1\"><text:span "
+                   "text:style-name=\"T1\">Lorem ipsum dolor sit amet, "
+                   "consectetur</text:span><text:s text:c=\"2\"/>adipiscing "
+                   "elit &amp; sed do<text:tab/>eiusmod tempor incididunt ut "
+                   "labore et dolore magna aliqua.</text:p>\n";
+        if (i % 100 == 0)
+            content += "<text:list><text:list-item><text:p>item</text:p>"
+                       "</text:list-item></text:list><table:table>"
+                       "<table:table-row><table:table-cell><text:p>cell"
+                       "</text:p></table:table-cell></table:table-row>"
+                       "</table:table>\n";
+    }
+    content += "</office:text></office:body></office:document-content>";
+
+    zip_t *zip = zip_open(path, ZIP_DEFAULT_COMPRESSION_LEVEL, 'w');
+    if (!zip)
+        return false;
+    bool ok = write_entry(zip, "mimetype",
+                          "application/vnd.oasis.opendocument.text") &&
+              write_entry(zip, "content.xml", content);
+    zip_close(zip);
+    return ok;
+}
+
+// Milliseconds taken by the fastest of the passes
+template <typename Pass>
+static double best_time(int passes, Pass pass) {
+    double best = 0;
+    for (int i = 0; i < passes; i++) {
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        pass();
+        std::chrono::duration<double, std::milli> took =
+            std::chrono::steady_clock::now() - start;
+        if (i == 0 || took.count() < best)
+            best = took.count();
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : generated;
+    int passes = argc > 2 ? atoi(argv[2]) : 10;
+    if (passes < 1)
+        passes = 1;
+    if (argc < 2 && !write_package(path)) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    std::string dom_text;
+    double dom = best_time(passes, [&] {
+        duckx::Document doc(path);
+        doc.open();
+        dom_text.clear();
+        doc.extract_text(dom_text);
+    });
+
+    // The extractor keeps its buffer from one pass to the next
+    std::string text;
+    duckx::TextExtractor extractor;
+    bool read = true;
+    double extracted = best_time(passes, [&] {
+        text.clear();
+        read = extractor.extract_package(path, text) && read;
+    });
+    if (!read) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: %zu bytes of text, best of %d passes\n", path, text.size(),
+           passes);
+    printf("open() + extract_text(): %8.2f ms\n", dom);
+    printf("TextExtractor:           %8.2f ms (%.1fx)\n", extracted,
+           extracted > 0 ? dom / extracted : 0.0);
+    if (text != dom_text) {
+        fprintf(stderr, "the texts differ\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
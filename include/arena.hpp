@@ -0,0 +1,58 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "pugixml/pugixml.hpp"
+
+namespace duckx {
+// Arena hands out memory for the XML pages of a document by bumping a
+// pointer through large blocks. Pages given back while the document is
+// edited are kept on a free list of their size class and handed out again
+// before the blocks grow; pages too large for a block come from the heap
+// and go straight back to it. reset() makes the blocks available again
+// for the next document, and they are released together when the arena
+// is destroyed.
+// An arena belongs to one document and is not shared between threads.
+class Arena : public pugi::xml_memory_resource {
+  private:
+    struct Block {
+        char *data;
+        size_t size;
+    };
+    std::vector<Block> blocks;
+    // Block being filled and the first free byte in it
+    size_t current;
+    size_t offset;
+    // Pages given back, by size class; each links to the next one
+    std::vector<void *> free_lists;
+
+  public:
+    Arena();
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t) override;
+    void deallocate(void *) override;
+
+    // Forget everything allocated so far but keep the blocks; no document
+    // may still use the memory
+    void reset();
+    // Give the blocks back to the system
+    void release();
+
+    // Bytes taken from the blocks since the last reset, given back pages
+    // included, and bytes held in blocks
+    size_t used() const;
+    size_t capacity() const;
+};
+} // namespace duckx
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef CONSTANTS_HPP
 #define CONSTANTS_HPP
 
+#include <cstddef>
+
 namespace duckx {
 typedef unsigned const int formatting_flag;
 
@@ -14,6 +16,18 @@ formatting_flag superscript = 1 << 4;
 formatting_flag subscript = 1 << 5;
 formatting_flag smallcaps = 1 << 6;
 formatting_flag shadow = 1 << 7;
+
+// Most spaces a text:s element is read as, whatever its text:c count, so
+// that a document cannot make the text readers allocate without bound
+const long max_space_count = 1024;
+
+// Spaces a text:s element with the given text:c count is read as
+inline size_t expanded_spaces(long count) {
+    if (count < 1)
+        return 1;
+    return static_cast<size_t>(count < max_space_count ? count
+                                                       : max_space_count);
+}
 } // namespace duckx
 
 #endif
\ No newline at end of file
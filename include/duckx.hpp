@@ -8,20 +8,31 @@
 #define DUCKX_H
 
 //#define DUCKX_EXPORT __declspec(dllexport)
-#ifdef DUCKX_EXPORTS
+#ifndef _WIN32
+    #define DUCKX_EXPORT
+#elif defined(DUCKX_EXPORTS)
     #define DUCKX_EXPORT __declspec(dllexport)
 #else
     #define DUCKX_EXPORT __declspec(dllimport)
 #endif
 
 #include <cstdio>
+#include <map>
+#include <memory>
 #include <stdlib.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 
+#include <arena.hpp>
 #include <constants.hpp>
 #include <duckxiterator.hpp>
+#include <mappedfile.hpp>
+#include <names.hpp>
+#include <streamreader.hpp>
+#include <streamwriter.hpp>
+#include <textextractor.hpp>
 #include "pugixml/pugixml.hpp"
 #include "zip/zip.h"
 
@@ -47,6 +58,39 @@
         run
     };
 
+// Context is the state a document shares with the handles pointing into
+// its content.xml
+struct DUCKX_EXPORT Context {
+    // Bumped by every modification made through the handles
+    unsigned long revision;
+    // Bumped when elements are added or removed through the handles
+    unsigned long structure;
+    // Prefixes of the namespaces in content.xml
+    Names names;
+
+    // Children of a node of one element kind, in document order
+    struct Children {
+        element kind;
+        std::vector<pugi::xml_node> nodes;
+    };
+    // Lists built on first use by position, also through const handles,
+    // and kept up to date by the handles adding or removing elements
+    mutable std::unordered_map<pugi::xml_node_struct *,
+                               std::vector<Children> > index;
+
+    Context() : revision(0), structure(0) {}
+    void touch() { ++this->revision; }
+
+    const std::vector<pugi::xml_node> &children(pugi::xml_node parent,
+                                                element kind) const;
+    // child was appended to parent
+    void appended(pugi::xml_node parent, element kind, pugi::xml_node child);
+    // An element was inserted before the last child of parent
+    void inserted(pugi::xml_node parent);
+    // An element was removed, its descendants may still be listed
+    void removed();
+};
+
 // Run contains runs in a paragraph
 class DUCKX_EXPORT Run {
   private:
@@ -55,12 +99,14 @@ class DUCKX_EXPORT Run {
     pugi::xml_node parent;
     // And store current node also
     pugi::xml_node current;
+    Context *context;
 
   public:
     Run();
     Run(pugi::xml_node, pugi::xml_node);
     void set_parent(pugi::xml_node);
     void set_current(pugi::xml_node);
+    void set_context(Context *);
 
     std::string get_text() const;
     bool set_text(const std::string &) const;
@@ -71,7 +117,7 @@ class DUCKX_EXPORT Run {
 };
 
 // Paragraph contains a paragraph
-// and stores runs
+// and gives access to its runs
 class DUCKX_EXPORT Paragraph {
   private:
     friend class IteratorHelper;
@@ -79,37 +125,55 @@ class DUCKX_EXPORT Paragraph {
     pugi::xml_node parent;
     // And store current node also
     pugi::xml_node current;
-    // A paragraph consists of runs
-    Run run;
+    Context *context;
 
   public:
     Paragraph();
     Paragraph(pugi::xml_node, pugi::xml_node);
     void set_parent(pugi::xml_node);
     void set_current(pugi::xml_node);
+    void set_context(Context *);
     // DELETE
-    void delete_par() { parent.remove_child(current); }
+    void delete_par();
     Paragraph &next();
     bool has_next() const;
 
-    Run &runs();
-    Run &add_run(const std::string &, std::string stylename = "RegText");
-    Run &add_run(const char *, const char* stylename = "RegText");
-    Paragraph &insert_paragraph_after(const std::string &,
+    // Runs of the paragraph, looked up when asked for
+    Run runs() const;
+    Run add_run(const std::string &, std::string stylename = "RegText");
+    Run add_run(const char *, const char* stylename = "RegText");
+    Paragraph insert_paragraph_after(const std::string &,
         std::string stylename = "P1");
 
     void add_image(const std::string& name, const std::string& width = "", const std::string& height = "");
     void set_style(const std::string& name);
 };
 
+// Block is a paragraph or a heading anywhere in the text, with the
+// elements it is nested in
+struct DUCKX_EXPORT Block {
+    // Handle on the paragraph or heading, its parent is the element it is
+    // directly in
+    Paragraph paragraph;
+    // element::paragraph or element::heading
+    element kind;
+    // Innermost element around it: a list item, a section, a table cell...
+    // or office_text at the top of the text
+    element container;
+    // Elements between the block and the text of the document
+    unsigned depth;
+    // Lists and table cells around the block
+    unsigned list_level;
+    unsigned table_level;
+};
+
 // TableCell contains one or more paragraphs
 class DUCKX_EXPORT TableCell {
   private:
     friend class IteratorHelper;
     pugi::xml_node parent;
     pugi::xml_node current;
-
-    Paragraph paragraph;
+    Context *context;
 
   public:
     TableCell();
@@ -117,12 +181,13 @@ class DUCKX_EXPORT TableCell {
 
     void set_parent(pugi::xml_node);
     void set_current(pugi::xml_node);
+    void set_context(Context *);
 
-    Paragraph &paragraphs();
+    Paragraph paragraphs() const;
 
     TableCell &next();
     bool has_next() const;
-    Paragraph& add_paragraph(const std::string&);
+    Paragraph add_paragraph(const std::string&);
 };
 
 // TableRow consists of one or more TableCells
@@ -130,22 +195,26 @@ class DUCKX_EXPORT TableRow {
     friend class IteratorHelper;
     pugi::xml_node parent;
     pugi::xml_node current;
-
-    TableCell cell;
+    Context *context;
 
   public:
     TableRow();
     TableRow(pugi::xml_node, pugi::xml_node);
     void set_parent(pugi::xml_node);
     void set_current(pugi::xml_node);
-    void delete_row() { parent.remove_child(current); }
-    TableCell &cells();
-    TableCell& add_cell(const std::string& cellstyle, const std::string& parstyle);
-    TableCell& add_cell(const std::string& cellstyle);
+    void set_context(Context *);
+    void delete_row();
+    TableCell cells() const;
+    TableCell add_cell(const std::string& cellstyle, const std::string& parstyle);
+    TableCell add_cell(const std::string& cellstyle);
     void add_covered_cell();
-    TableCell& add_united_cell(const std::string& cellstyle, const std::string& parstyle, const int united_cell_columns, const int united_cell_rows = 1);
+    TableCell add_united_cell(const std::string& cellstyle, const std::string& parstyle, const int united_cell_columns, const int united_cell_rows = 1);
     bool has_next() const;
     TableRow &next();
+
+    // Cell at a position and number of cells, without walking the row
+    TableCell cell_at(size_t) const;
+    size_t cell_count() const;
 };
 
 // Table consists of one or more TableRow objects
@@ -154,21 +223,25 @@ class DUCKX_EXPORT Table {
     friend class IteratorHelper;
     pugi::xml_node parent;
     pugi::xml_node current;
-
-    TableRow row;
+    Context *context;
 
   public:
     Table();
     Table(pugi::xml_node, pugi::xml_node);
     void set_parent(pugi::xml_node);
     void set_current(pugi::xml_node);
+    void set_context(Context *);
 
     Table &next();
     bool has_next() const;
 
-    TableRow &rows();
-    TableRow& add_row(const std::string& stylename);
+    TableRow rows() const;
+    TableRow add_row(const std::string& stylename);
     void add_column(const std::vector<std::string>& stylenames);
+
+    // Row at a position and number of rows, without walking the table
+    TableRow row_at(size_t) const;
+    size_t row_count() const;
 };
 class DUCKX_EXPORT Style
 {
@@ -177,46 +250,342 @@ private:
     friend class IteratorHelper;
     pugi::xml_node parent;
     pugi::xml_node current;
+    Context *context;
 public:
     Style();
     Style(pugi::xml_node, pugi::xml_node);
     void set_parent(pugi::xml_node);
     void set_current(pugi::xml_node);
+    void set_context(Context *);
 
     Style& next();
     bool has_next() const;
 
-    Style& add_style(std::string stylename, styles st, std::vector<std::pair<std::string, std::string>> attr);
+    Style add_style(std::string stylename, styles st, std::vector<std::pair<std::string, std::string>> attr);
+
+};
+
+// Span points to bytes owned by the document, e.g. a stored package entry
+struct DUCKX_EXPORT Span {
+    const char *data;
+    size_t size;
+};
 
+// Options used when the package is written
+struct DUCKX_EXPORT SaveOptions {
+    // Threads deflating content.xml and the other entries written by
+    // duckX; 1 keeps the work on the calling thread, 0 uses one per
+    // hardware thread
+    unsigned threads;
+    // Compression level of the entries written by duckX
+    int level;
+    // Deflate the entries of the original package again at `level`
+    // instead of copying their compressed bytes ("mimetype" stays stored)
+    bool recompress;
+
+    SaveOptions()
+        : threads(1), level(ZIP_DEFAULT_COMPRESSION_LEVEL),
+          recompress(false) {}
 };
 
+// How save() writes the package back to its file
+enum class SaveMode {
+    // Write a new package in place of the original one
+    rewrite,
+    // Append the changed entries and a new central directory to the file,
+    // the replaced entries stay in the file until compact(). With
+    // SaveOptions::recompress every entry is written again, so the file is
+    // rewritten instead.
+    append
+};
+
+// Writer receives the saved package in consecutive blocks
+class DUCKX_EXPORT Writer {
+  public:
+    virtual ~Writer() {}
+    virtual void write(const void *data, size_t size) = 0;
+};
+
+class TemplateCache;
+class Merge;
+class DeflatePool;
+
 // Document contains whole the docx file
 // and stores paragraphs
 class DUCKX_EXPORT Document {
   private:
     friend class IteratorHelper;
+    friend class TemplateCache;
+    friend class Merge;
     std::string directory;
+    // Package bytes when the document was opened from memory
+    std::vector<char> buffer;
+    // Package bytes of the template the document was instantiated from
+    std::shared_ptr<const std::vector<char> > shared_package;
+    // Package mapping when the document was opened with open_mapped(),
+    // save() maps the file again once it has been replaced
+    mutable MappedFile mapping;
     Paragraph paragraph;
     Table table;
     Style style;
+    // Pages of content.xml and the parts, recycled when another package is
+    // opened; declared before the documents so that it outlives them, and
+    // kept on the heap since the pages stay with it when the documents are
+    // moved
+    std::unique_ptr<Arena> arena;
     pugi::xml_document document;
+    // Inflated content.xml, parsed in place
+    std::vector<char> content_text;
+    // Reader on the package, pointed at the next package on reopen() so
+    // that its allocations are reused
+    mutable zip_t *reader;
+    mutable bool reader_ready;
+    // Shared with the handles, kept on the heap so that its address does
+    // not change when the document is moved
+    std::unique_ptr<Context> context;
+    // Revision of content.xml in the original package
+    mutable unsigned long saved_revision;
+    // Blocks of the text, and the structure of the context they were
+    // listed for
+    mutable std::vector<Block> block_list;
+    mutable unsigned long block_structure;
+    SaveOptions options;
+    // Files added to the package, written on save
+    mutable std::vector<std::pair<std::string, std::vector<char> > > files;
+
+    // XML entry of the package other than content.xml, parsed on first use
+    struct Part {
+        std::string name;
+        pugi::xml_document document;
+        // Handed out for writing, so compared with `printed` on save
+        bool touched;
+        // Inflated entry parsed in place, and the entry serialized on save
+        std::vector<char> text;
+        std::vector<char> output;
+        // The part as printed when it was handed out or last saved
+        std::vector<char> printed;
+    };
+    mutable std::vector<std::unique_ptr<Part> > parts;
+    // Parts of previous packages, emptied and kept for their buffers
+    mutable std::vector<std::unique_ptr<Part> > spare_parts;
+
+    Part &load_part(const std::string &) const;
+    // Print a touched part into its output, true if it differs from what
+    // the file holds
+    bool changed(Part &) const;
+
+    // Bytes of the original package, when it is in memory
+    Span package_bytes() const;
+    // Open the original package for reading
+    zip_t *open_package() const;
+    // Shared reader on the original package, not to be closed
+    zip_t *package() const;
+    // Let go of the original package before it is replaced or unmapped
+    void release_package() const;
+    // Drop the loaded entries, keeping their memory
+    void clear_content();
+    // Elements of content.xml, found by kind
+    pugi::xml_node body() const;
+    pugi::xml_node office_text() const;
+    pugi::xml_node automatic_styles() const;
+    // Start from a copy of a parsed content.xml of the given package
+    void open_copy(const std::shared_ptr<const std::vector<char> > &,
+                   const pugi::xml_document &);
+    // Write content.xml and the untouched entries of the original package
+    void write_package(zip_t *, const SaveOptions &) const;
+    void write_content(zip_t *, const SaveOptions &, DeflatePool &) const;
+    // Write the package to a temporary file and move it over the original
+    void replace_file(const SaveOptions &) const;
+    // The file holds every change, so the next save has nothing to write
+    void mark_saved() const;
 
   public:
     Document();
     Document(std::string);
+    ~Document();
+    Document(const Document &) = delete;
+    Document &operator=(const Document &) = delete;
+    // The package, the parsed entries and their memory go to the new
+    // document; the handles of the old one follow it, and the old one is
+    // left empty
+    Document(Document &&);
+    Document &operator=(Document &&);
     void file(std::string);
     void open();
+    // Close the package but keep the memory of the document, its zip
+    // reader and its buffers for the next one
+    void reset();
+    // Open another package with the memory kept by reset()
+    void reopen(const std::string &);
+    void reopen(const void *data, size_t size);
+    // Open a package held in memory, the bytes are copied. The document
+    // no longer refers to a file, so save() writes nothing; use
+    // save_copy(), save_to_buffer() or save_to()
+    void open_from_memory(const void *data, size_t size);
+    // Map the file instead of reading it, entries are inflated straight
+    // from the mapping
+    void open_mapped();
+    // Options used by the save functions called without options
+    void set_save_options(const SaveOptions &);
+    const SaveOptions &save_options() const;
+
+    // Whether saving would write anything but a copy of the original
+    // package: content.xml was modified through the handles, a part was
+    // changed or a file was added
+    bool modified() const;
+    bool modified(const SaveOptions &) const;
+
     void save() const;
+    void save(const SaveOptions &) const;
+    void save(SaveMode) const;
+    // Rewrite the file without the entries replaced by appending saves
+    void compact() const;
     void save_copy(std::string) const;
+    void save_copy(std::string, const SaveOptions &) const;
+    void save_to_buffer(std::vector<char> &) const;
+    void save_to_buffer(std::vector<char> &, const SaveOptions &) const;
+    void save_to(Writer &) const;
+
+    // Parsed XML entries of the package, loaded the first time they are
+    // asked for. Parts obtained through a non-const document are written
+    // again on save if they were changed, the others are copied from the
+    // original package.
+    pugi::xml_document &part(const std::string &name);
+    const pugi::xml_document &part(const std::string &name) const;
+    // styles.xml (styles() returns the automatic styles of content.xml)
+    pugi::xml_document &styles_xml();
+    const pugi::xml_document &styles_xml() const;
+    pugi::xml_document &meta();
+    const pugi::xml_document &meta() const;
+    pugi::xml_document &manifest();
+    const pugi::xml_document &manifest() const;
+
+    // Add a file to the package, replacing the entry of the same name
+    void add_file(const std::string &name, const void *data, size_t size);
+    // Add an image under "media/", as referenced by Paragraph::add_image,
+    // and list it in META-INF/manifest.xml
+    void add_media(const std::string &name, const void *data, size_t size);
+
+    // Bytes of an entry stored without compression (e.g. "mimetype"),
+    // only available for mapped or in-memory documents; empty otherwise
+    Span stored_entry(const std::string &name) const;
 
     Paragraph &paragraphs();
     Table &tables();
     Style& styles();
 
-    Table& add_table(const std::string& stylename);
-    Paragraph& add_paragraph(const std::string& stylename);
+    Table add_table(const std::string& stylename);
+    Paragraph add_paragraph(const std::string& stylename);
+
+    // Paragraph or table of the text at a position, and their number. The
+    // positions are indexed the first time they are asked for.
+    Paragraph paragraph_at(size_t) const;
+    size_t paragraph_count() const;
+    Table table_at(size_t) const;
+    size_t table_count() const;
+
+    // Paragraphs and headings at every depth of the text, in lists,
+    // sections and table cells too, in document order. They are listed in
+    // one pass when first asked for, and again once elements were added or
+    // removed through the handles.
+    const std::vector<Block> &blocks() const;
+
+    // Append the plain text of the document to out, in one walk of the
+    // tree: every paragraph and heading ends with a line feed, text:s,
+    // text:tab and text:line-break become spaces, tabs and line feeds.
+    // TextExtractor gives the same text without opening the document.
+    void extract_text(std::string &out) const;
+
+
+};
+
+// TemplateCache keeps a package parsed in memory, for documents which are
+// created from the same template over and over. The cache does not change
+// once loaded, so documents can be instantiated from several threads.
+class DUCKX_EXPORT TemplateCache {
+  private:
+    std::shared_ptr<const std::vector<char> > package;
+    pugi::xml_document content;
+    // Inflated content.xml, parsed in place
+    std::vector<char> content_text;
+
+    bool parse();
 
+  public:
+    TemplateCache();
+    TemplateCache(const TemplateCache &) = delete;
+    TemplateCache &operator=(const TemplateCache &) = delete;
+
+    bool load(const std::string &);
+    bool load(const void *data, size_t size);
+    bool loaded() const;
+
+    // A document with a copy of content.xml and no file of its own (save
+    // it with save_copy() or save_to_buffer()). The other entries are read
+    // from the cached package when needed, and written from its
+    // compressed bytes unless they were changed.
+    std::unique_ptr<Document> instantiate() const;
+    // Same, reusing the memory of an existing document
+    void instantiate(Document &) const;
+};
+
+// Merge fills the placeholders of a document, e.g. "{{name}}", from one
+// record after another. content.xml is scanned once: every text node
+// holding a part of a placeholder is indexed, also when the placeholder is
+// split over several runs, so filling a record only rewrites those nodes.
+class DUCKX_EXPORT Merge {
+  public:
+    // Values by placeholder name; placeholders missing from a record keep
+    // their text, so filling an empty record restores the template
+    typedef std::map<std::string, std::string> Record;
 
+  private:
+    // Part of the text of an indexed node: literal text, or the value of a
+    // placeholder starting in the node
+    struct Piece {
+        std::string text;
+        // Index in names, -1 for literal text
+        int field;
+    };
+    struct Slot {
+        pugi::xml_node node;
+        std::vector<Piece> pieces;
+    };
+
+    Document &document;
+    std::string open;
+    std::string close;
+    std::vector<std::string> names;
+    std::vector<Slot> slots;
+    size_t count;
+    // Revision of the document the index was built for
+    unsigned long revision;
+    // Scratch space for filling a node
+    std::string value;
+
+    void scan(pugi::xml_node, std::vector<pugi::xml_node> &);
+    void index(const std::vector<pugi::xml_node> &);
+
+  public:
+    explicit Merge(Document &, const std::string &open = "{{",
+                   const std::string &close = "}}");
+
+    // Scan content.xml again. fill() does so by itself when the document
+    // was changed otherwise; placeholders which hold a value by then are
+    // not found again, so fill an empty record before such changes.
+    void rebuild();
+
+    // Names of the placeholders, in order of first appearance
+    const std::vector<std::string> &fields() const;
+    // Number of placeholders in the document
+    size_t size() const;
+
+    // Write the values of a record into the document
+    void fill(const Record &);
+    // Fill each record in turn and save the document for it, one package
+    // per record
+    void merge(const std::vector<Record> &,
+               std::vector<std::vector<char> > &outputs);
 };
 } // namespace duckx
 
@@ -7,71 +7,86 @@
 #ifndef DUCKXITERATOR_H
 #define DUCKXITERATOR_H
 
+#include <cstddef>
+#include <iterator>
+
 namespace pugi {
 class xml_node;
 }
 
 namespace duckx {
-template <class T, class P, class C = P> class Iterator {
+class IteratorHelper {
+  private:
+    template <class T> friend class Iterator;
+
+    template <class T> static auto current(T const &obj) -> decltype(obj.current) {
+        return obj.current;
+    }
+
+    template <class T> static void clear(T &obj) {
+        obj.current = decltype(obj.current)();
+    }
+};
+
+// Iterator walks the siblings of a handle with the handle's own next(), so
+// that only elements of the handle's kind are visited. The handle is kept
+// in the iterator and only moved on by operator++, so dereferencing it is
+// free. Iterators over the same elements may be copied and used
+// independently, as required of forward iterators.
+template <class T> class Iterator {
   private:
-    using ParentType = P;
-    using CurrentType = C;
-    ParentType parent{0};
-    CurrentType current{0};
-    mutable T buffer{};
+    T handle{};
 
   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T const *;
+    using reference = T const &;
+
     Iterator() = default;
 
-    Iterator(ParentType parent, CurrentType current)
-        : parent(parent), current(current) {}
+    explicit Iterator(T const &handle) : handle(handle) {}
 
-    bool operator!=(const Iterator &other) const {
-        return parent != other.parent || current != other.current;
+    bool operator==(const Iterator &other) const {
+        return IteratorHelper::current(this->handle) ==
+               IteratorHelper::current(other.handle);
     }
 
-    bool operator==(const Iterator &other) const {
-        return !this->operator!=(other);
+    bool operator!=(const Iterator &other) const {
+        return !this->operator==(other);
     }
 
     Iterator &operator++() {
-        this->current = this->current.next_sibling();
+        this->handle.next();
         return *this;
     }
 
-    auto operator*() const -> T const & {
-        // Only update the buffer when the user wants to accces to the data
-        buffer.set_parent(parent);
-        buffer.set_current(current);
-        return buffer;
+    Iterator operator++(int) {
+        Iterator previous = *this;
+        this->handle.next();
+        return previous;
     }
 
-    auto operator-> () const -> T const * { return &(this->operator*()); }
-};
+    reference operator*() const { return this->handle; }
 
-class IteratorHelper {
-  private:
-    using P = pugi::xml_node;
-    template <class T> static auto make_begin(T const &obj) -> Iterator<T, P> {
-        return Iterator<T, P>(obj.parent, obj.current);
-    }
+    pointer operator->() const { return &this->handle; }
 
-    template <class T> static auto make_end(T const &obj) -> Iterator<T, P> {
-        return Iterator<T, P>(obj.parent,
-                              static_cast<decltype(obj.current)>(0));
+    // The handle with no current element, where the iteration ends
+    static Iterator end_of(T const &obj) {
+        Iterator last(obj);
+        IteratorHelper::clear(last.handle);
+        return last;
     }
-
-    template <class T> friend auto begin(T const &) -> Iterator<T, P>;
-    template <class T> friend auto end(T const &) -> Iterator<T, P>;
 };
 
 // Entry point
-template <class T> auto begin(T const &obj) -> Iterator<T, pugi::xml_node> {
-    return IteratorHelper::make_begin(obj);
+template <class T> auto begin(T const &obj) -> Iterator<T> {
+    return Iterator<T>(obj);
 }
 
-template <class T> auto end(T const &obj) -> Iterator<T, pugi::xml_node> {
-    return IteratorHelper::make_end(obj);
+template <class T> auto end(T const &obj) -> Iterator<T> {
+    return Iterator<T>::end_of(obj);
 }
 } // namespace duckx
 
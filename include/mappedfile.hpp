@@ -0,0 +1,41 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace duckx {
+// MappedFile maps a whole file read-only into memory.
+// The pages come from the page cache, so every process mapping the same
+// file shares them.
+class MappedFile {
+  private:
+    const char *address;
+    size_t length;
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#endif
+
+  public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&);
+    MappedFile &operator=(MappedFile &&);
+
+    bool map(const std::string &);
+    void unmap();
+
+    const char *data() const { return this->address; }
+    size_t size() const { return this->length; }
+};
+} // namespace duckx
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+#ifndef NAMES_HPP
+#define NAMES_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace duckx {
+// Namespaces of the elements and attributes written or looked for by duckX
+enum class xmlns : unsigned char {
+    none,
+    office,
+    text,
+    table,
+    style,
+    draw,
+    svg,
+    xlink,
+    count
+};
+
+// Elements known to duckX. The kind of every element of content.xml is set
+// when it is loaded or added by the handles, so finding the next one
+// compares integers instead of names.
+enum class element : unsigned char {
+    unclassified,
+    other,
+    document_content,
+    body,
+    office_text,
+    automatic_styles,
+    paragraph,
+    heading,
+    span,
+    space,
+    tab,
+    line_break,
+    table,
+    table_row,
+    table_cell,
+    covered_table_cell,
+    list,
+    list_item,
+    list_header,
+    section,
+    style,
+    count
+};
+
+// Names resolves the elements of a document by namespace rather than by
+// prefix, so that documents binding the ODF namespaces to other prefixes
+// than the usual "text:", "table:"... are read the same way. The prefixes
+// are taken from the xmlns attributes of the root element; elements added
+// to the document use them too. Unprefixed attributes are in no namespace,
+// so attributes are always written with a prefix, even for a namespace
+// bound as the default namespace.
+class Names {
+  private:
+    // Prefixes of the elements and of the attributes of each namespace
+    std::string prefixes[static_cast<int>(xmlns::count)];
+    std::string attribute_prefixes[static_cast<int>(xmlns::count)];
+    // Namespaces bound as the default namespace, and with a prefix
+    bool defaults[static_cast<int>(xmlns::count)];
+    bool declared[static_cast<int>(xmlns::count)];
+    // Prefixes bound in the document, to any namespace
+    std::vector<std::string> bound;
+    std::string names[static_cast<int>(element::count)];
+
+    void update();
+
+  public:
+    // The usual ODF prefixes
+    Names();
+    void reset();
+
+    // Take an attribute of the root element into account, xmlns:p="uri"
+    // or xmlns="uri"
+    void bind(const char *attribute, const char *uri);
+
+    // Kind of an element with the given qualified name
+    element classify(const char *name) const;
+    element classify(const char *name, size_t size) const;
+
+    // Qualified name of an element of the given kind
+    const char *name(element kind) const {
+        return this->names[static_cast<int>(kind)].c_str();
+    }
+    // Qualified name of any element in a known namespace
+    std::string qualify(xmlns space, const char *local) const;
+    // Qualified name of an attribute in a known namespace
+    std::string attribute(xmlns space, const char *local) const;
+
+    // Bind a prefix to every namespace which has none yet, because it was
+    // bound as the default namespace only or not at all. Returns the xmlns
+    // attributes to add to the root element for them.
+    std::vector<std::pair<std::string, std::string> > declare();
+};
+} // namespace duckx
+
+#endif
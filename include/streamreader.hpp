@@ -0,0 +1,98 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+#ifndef STREAMREADER_HPP
+#define STREAMREADER_HPP
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "names.hpp"
+#include "zip/zip.h"
+
+namespace duckx {
+// StreamReader walks content.xml as a series of events instead of building
+// a DOM. The entry is inflated a block at a time as the events are asked
+// for, so memory is bounded by the inflate window and the longest single
+// tag or text, not by the size of the document.
+// Events use the elements of the Paragraph, Run and Table classes: text:p
+// (and text:h) for paragraphs, table:table, table:table-row and
+// table:table-cell (and table:covered-table-cell). Text is reported inside
+// paragraphs only, with text:s, text:tab and text:line-break turned into
+// spaces, tabs and line feeds. Elements are resolved by namespace, with
+// the prefixes declared on the root element.
+class StreamReader {
+  public:
+    enum class Event {
+        end,
+        error,
+        paragraph_begin,
+        paragraph_end,
+        text,
+        table_begin,
+        table_end,
+        row_begin,
+        row_end,
+        cell_begin,
+        cell_end
+    };
+
+  private:
+    zip_t *zip;
+    // Inflated bytes, data[pos, avail) is still to be parsed
+    std::vector<char> data;
+    size_t pos;
+    size_t avail;
+    bool eof;
+    bool failed;
+    // End event of an element written as <name/>
+    bool pending;
+    Event pending_event;
+    // Depth of nested paragraphs
+    int paragraphs;
+    // Prefixes of the document, taken from the root element
+    Names names;
+    bool bound;
+    std::string space_count;
+    // Text of the last text event, element and attributes of the last
+    // begin or end event
+    std::string value;
+    std::string tag;
+    std::vector<std::pair<std::string, std::string> > attributes;
+
+    bool fill();
+    bool starts_with(const char *);
+    size_t search(const char *, size_t);
+    size_t tag_end();
+    void parse_tag(const char *, size_t, bool);
+    bool start();
+
+  public:
+    StreamReader();
+    ~StreamReader();
+    StreamReader(const StreamReader &) = delete;
+    StreamReader &operator=(const StreamReader &) = delete;
+
+    // Start reading the content.xml of a package
+    bool open(const std::string &);
+    // The bytes must stay valid until the reader is closed
+    bool open(const void *data, size_t size);
+    void close();
+
+    // Next event, Event::end after the last one
+    Event next();
+
+    // Text of a text event
+    const std::string &text() const;
+    // Element of a begin or end event, e.g. "table:table-cell"
+    const std::string &name() const;
+    // Attribute of the element of a begin event, empty if missing
+    std::string attribute(const std::string &) const;
+};
+} // namespace duckx
+
+#endif
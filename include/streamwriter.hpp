@@ -0,0 +1,77 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+#ifndef STREAMWRITER_HPP
+#define STREAMWRITER_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "names.hpp"
+#include "zip/zip.h"
+
+namespace duckx {
+// StreamWriter writes a new package from a template, appending paragraphs
+// and tables to the text of the template as they are added. The elements
+// are deflated into content.xml right away instead of being kept in a DOM,
+// so memory stays the same however many rows are written. The other
+// entries of the template are copied without recompressing them.
+// Elements are forward-only: adding a row ends the open row, adding a cell
+// ends the open cell, and so on. Unlike Document, nothing can be read back
+// or changed once it was added. Elements are written with the prefixes of
+// the template.
+class StreamWriter {
+  private:
+    zip_t *zip;
+    zip_t *source;
+    // Template entries still to be copied after content.xml
+    int next_entry;
+    // content.xml of the template before and after the added elements
+    std::string tail;
+    // Prefixes of the template, and the style attributes written with them
+    Names names;
+    std::string text_style;
+    std::string table_style;
+    // Elements which are open, innermost last
+    std::vector<element> open_elements;
+    // Output not yet handed to the deflater
+    std::string out;
+
+    void begin(element, const std::string &, const std::string &);
+    void end();
+    void end_until(element, element);
+    void escape(const std::string &, bool);
+    void flush();
+
+  public:
+    StreamWriter();
+    ~StreamWriter();
+    StreamWriter(const StreamWriter &) = delete;
+    StreamWriter &operator=(const StreamWriter &) = delete;
+
+    // Start the package output from the package template
+    bool open(const std::string &template_path, const std::string &output);
+    // Finish the package, also done by the destructor
+    bool close();
+    bool is_open() const;
+
+    // Paragraphs go to the open cell, or to the text of the document
+    void add_paragraph(const std::string &stylename = "");
+    // Runs go to the open paragraph, or to a new one
+    void add_run(const std::string &text, const std::string &stylename = "");
+
+    // Tables go to the open cell, or to the text of the document
+    void add_table(const std::string &stylename = "");
+    void add_column(const std::vector<std::string> &stylenames);
+    void add_row(const std::string &stylename = "");
+    // Cells start with a paragraph, like TableRow::add_cell
+    void add_cell(const std::string &cellstyle = "",
+                  const std::string &parstyle = "");
+    void end_table();
+};
+} // namespace duckx
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+#ifndef TEXTEXTRACTOR_HPP
+#define TEXTEXTRACTOR_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "names.hpp"
+#include "zip/zip.h"
+
+namespace duckx {
+// TextExtractor reads the plain text of content.xml straight from its
+// bytes, without building a DOM or reporting events. The text is the same
+// as Document::extract_text(): every paragraph and heading of office:body
+// ends with a line feed, text:s, text:tab and text:line-break are turned
+// into spaces, tabs and line feeds, line ends are normalized to line feeds
+// as by the parser, and character data outside paragraphs is left out.
+// Elements are resolved by namespace, with the prefixes declared on the
+// root element. Markup and references are looked for 16 bytes at a time
+// with SSE2 when the target has it.
+class TextExtractor {
+  private:
+    // Prefixes of the last document
+    Names names;
+    std::string space_count;
+    std::string text_prefix;
+    std::string body_name;
+    // Inflated content.xml, kept for the next package
+    std::vector<char> content;
+
+    void bind(const char *, const char *);
+    element classify(const char *, size_t) const;
+    bool extract_content(zip_t *, std::string &);
+
+  public:
+    TextExtractor();
+
+    // Append the text of a content.xml held in memory to out, false if it
+    // ends in the middle of markup
+    bool extract(const char *xml, size_t size, std::string &out);
+    // Append the text of the content.xml of a package, false if it cannot
+    // be read
+    bool extract_package(const std::string &path, std::string &out);
+    // The bytes of the package are only read during the call
+    bool extract_package(const void *data, size_t size, std::string &out);
+};
+} // namespace duckx
+
+#endif
@@ -0,0 +1,115 @@
+#include "arena.hpp"
+
+#include <cstdlib>
+
+// Blocks are big enough for several pugixml pages, larger requests come
+// straight from the heap
+static const size_t block_size = 256 * 1024;
+
+// Alignment of the blocks returned by malloc, and room kept in front of
+// every page for its size
+static const size_t block_alignment = 16;
+
+// Pages are rounded up to whole size classes so that a given back page
+// fits any later request of its class
+static const size_t size_class = 1024;
+
+duckx::Arena::Arena()
+    : current(0), offset(0), free_lists(block_size / size_class + 1) {}
+
+duckx::Arena::~Arena() { this->release(); }
+
+void *duckx::Arena::allocate(size_t size) {
+    size = (size + block_alignment + size_class - 1) & ~(size_class - 1);
+
+    // Too large for a block, so it is not worth keeping either
+    if (size > block_size) {
+        char *memory = static_cast<char *>(malloc(size));
+        if (!memory)
+            return NULL;
+        *reinterpret_cast<size_t *>(memory) = size;
+        return memory + block_alignment;
+    }
+
+    // A page of the same class given back earlier
+    void *&head = this->free_lists[size / size_class];
+    if (head) {
+        void *memory = head;
+        head = *static_cast<void **>(memory);
+        return memory;
+    }
+
+    char *memory = NULL;
+    // Move on to the next kept block once the current one is full
+    while (this->current < this->blocks.size()) {
+        Block &block = this->blocks[this->current];
+        if (block.size - this->offset >= size) {
+            memory = block.data + this->offset;
+            this->offset += size;
+            break;
+        }
+        if (this->current + 1 == this->blocks.size())
+            break;
+        this->current++;
+        this->offset = 0;
+    }
+
+    if (!memory) {
+        Block block;
+        block.size = block_size;
+        block.data = static_cast<char *>(malloc(block.size));
+        if (!block.data)
+            return NULL;
+
+        this->blocks.push_back(block);
+        this->current = this->blocks.size() - 1;
+        this->offset = size;
+        memory = block.data;
+    }
+
+    *reinterpret_cast<size_t *>(memory) = size;
+    return memory + block_alignment;
+}
+
+void duckx::Arena::deallocate(void *page) {
+    if (!page)
+        return;
+    char *memory = static_cast<char *>(page) - block_alignment;
+    size_t size = *reinterpret_cast<size_t *>(memory);
+    if (size > block_size) {
+        free(memory);
+        return;
+    }
+
+    void *&head = this->free_lists[size / size_class];
+    *static_cast<void **>(page) = head;
+    head = page;
+}
+
+void duckx::Arena::reset() {
+    this->current = 0;
+    this->offset = 0;
+    for (size_t i = 0; i < this->free_lists.size(); i++)
+        this->free_lists[i] = NULL;
+}
+
+void duckx::Arena::release() {
+    for (size_t i = 0; i < this->blocks.size(); i++)
+        free(this->blocks[i].data);
+    this->blocks.clear();
+    this->reset();
+}
+
+size_t duckx::Arena::used() const {
+    size_t total = this->offset;
+    for (size_t i = 0; i < this->current && i < this->blocks.size(); i++)
+        total += this->blocks[i].size;
+    return total;
+}
+
+size_t duckx::Arena::capacity() const {
+    size_t total = 0;
+    for (size_t i = 0; i < this->blocks.size(); i++)
+        total += this->blocks[i].size;
+    return total;
+}
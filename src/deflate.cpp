@@ -0,0 +1,381 @@
+#include "deflate.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#define MINIZ_HEADER_FILE_ONLY
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include "zip/miniz.h"
+
+// Uncompressed size of a block, same as pigz
+static const size_t DEFLATE_BLOCK_SIZE = 128 * 1024;
+
+static mz_bool block_put_buf(const void *buf, int len, void *user) {
+    std::vector<char> *out = static_cast<std::vector<char> *>(user);
+    const char *bytes = static_cast<const char *>(buf);
+    out->insert(out->end(), bytes, bytes + len);
+    return MZ_TRUE;
+}
+
+duckx::DeflatePool::DeflatePool(unsigned threads,
+                                std::function<zip_t *()> open_source)
+    : open_source(open_source), threads(threads > 1 ? threads : 0),
+      stopping(false) {
+    this->own.comp = NULL;
+    this->own.source = NULL;
+}
+
+duckx::DeflatePool::~DeflatePool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->job_ready.notify_all();
+    for (size_t i = 0; i < this->workers.size(); i++)
+        this->workers[i].join();
+
+    if (this->own.source)
+        zip_close(this->own.source);
+    free(this->own.comp);
+}
+
+unsigned duckx::DeflatePool::size() const { return this->threads; }
+
+void duckx::DeflatePool::run(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->jobs.push_back(job);
+    }
+    if (this->workers.empty())
+        for (unsigned i = 0; i < this->threads; i++)
+            this->workers.push_back(std::thread(&DeflatePool::work, this));
+    this->job_ready.notify_one();
+}
+
+duckx::DeflatePool::Scratch &duckx::DeflatePool::scratch() {
+    if (!this->own.comp)
+        this->own.comp = malloc(sizeof(tdefl_compressor));
+    return this->own;
+}
+
+zip_t *duckx::DeflatePool::source(Scratch &scratch) {
+    if (!scratch.source)
+        scratch.source = this->open_source();
+    return scratch.source;
+}
+
+void duckx::DeflatePool::work() {
+    std::unique_ptr<tdefl_compressor> comp(new tdefl_compressor);
+    Scratch scratch;
+    scratch.comp = comp.get();
+    scratch.source = NULL;
+
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->job_ready.wait(lock, [this] {
+                return this->stopping || !this->jobs.empty();
+            });
+            if (this->jobs.empty())
+                break;
+            job.swap(this->jobs.front());
+            this->jobs.pop_front();
+        }
+        job(scratch);
+    }
+
+    if (scratch.source)
+        zip_close(scratch.source);
+}
+
+duckx::ParallelDeflateWriter::ParallelDeflateWriter(zip_t *zip,
+                                                    DeflatePool &pool,
+                                                    int level)
+    : zip(zip), pool(pool), level(level), block_size(DEFLATE_BLOCK_SIZE),
+      max_blocks(2 * pool.size() + 1), failed(false) {}
+
+duckx::ParallelDeflateWriter::~ParallelDeflateWriter() {
+    // The pool may still be compressing blocks of this writer
+    std::unique_lock<std::mutex> lock(this->mutex);
+    for (size_t i = 0; i < this->blocks.size(); i++) {
+        Block *block = this->blocks[i].get();
+        this->block_done.wait(lock, [block] { return block->done; });
+    }
+}
+
+void duckx::ParallelDeflateWriter::write(const void *data, size_t size) {
+    const char *bytes = static_cast<const char *>(data);
+
+    while (size > 0) {
+        if (!this->current) {
+            this->current.reset(new Block());
+            this->current->input.reserve(this->block_size);
+        }
+
+        std::vector<char> &input = this->current->input;
+        size_t n = std::min(size, this->block_size - input.size());
+        input.insert(input.end(), bytes, bytes + n);
+        bytes += n;
+        size -= n;
+
+        if (input.size() == this->block_size)
+            this->submit();
+    }
+}
+
+void duckx::ParallelDeflateWriter::submit() {
+    Block *block = this->current.get();
+    block->done = false;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->blocks.push_back(std::move(this->current));
+    }
+    this->pool.run([this, block](DeflatePool::Scratch &scratch) {
+        this->compress(*block, scratch);
+    });
+
+    // Write what is ready, and bound the memory held by pending blocks
+    this->flush(false);
+    while (this->blocks.size() >= this->max_blocks)
+        this->flush(true);
+}
+
+void duckx::ParallelDeflateWriter::flush(bool wait) {
+    while (!this->blocks.empty()) {
+        Block *block = this->blocks.front().get();
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            if (!block->done && !wait)
+                return;
+            this->block_done.wait(lock, [block] { return block->done; });
+        }
+
+        if (zip_entry_write_deflated(this->zip, block->output.data(),
+                                     block->output.size(),
+                                     block->input.size(), block->crc) < 0)
+            this->failed = true;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->blocks.pop_front();
+        }
+
+        // Only wait for the first block, the others are written if ready
+        wait = false;
+    }
+}
+
+void duckx::ParallelDeflateWriter::compress(Block &block,
+                                            DeflatePool::Scratch &scratch) {
+    tdefl_compressor *comp = static_cast<tdefl_compressor *>(scratch.comp);
+    mz_uint flags = tdefl_create_comp_flags_from_zip_params(
+        this->level, -15, MZ_DEFAULT_STRATEGY);
+
+    // Each block starts from an empty dictionary and ends on a byte
+    // boundary, so it can follow any other block in the stream
+    block.output.reserve(block.input.size() / 2);
+    tdefl_init(comp, block_put_buf, &block.output, flags);
+    tdefl_compress_buffer(comp, block.input.data(), block.input.size(),
+                          TDEFL_SYNC_FLUSH);
+    block.crc = (unsigned int)mz_crc32(
+        MZ_CRC32_INIT,
+        reinterpret_cast<const unsigned char *>(block.input.data()),
+        block.input.size());
+
+    // Notified under the lock, since the writer may be destroyed as soon as
+    // it sees the last block done
+    std::lock_guard<std::mutex> lock(this->mutex);
+    block.done = true;
+    this->block_done.notify_all();
+}
+
+bool duckx::ParallelDeflateWriter::finish() {
+    if (this->current && !this->current->input.empty())
+        this->submit();
+    this->current.reset();
+
+    while (!this->blocks.empty())
+        this->flush(true);
+
+    // Empty final block with fixed Huffman codes: BFINAL=1, BTYPE=01, EOB
+    static const unsigned char last_block[2] = {0x03, 0x00};
+    if (zip_entry_write_deflated(this->zip, last_block, sizeof(last_block), 0,
+                                 0) < 0)
+        this->failed = true;
+
+    return !this->failed;
+}
+
+duckx::EntryDeflater::EntryDeflater(DeflatePool &pool, int level)
+    : pool(pool), level(level), queued(0) {}
+
+duckx::EntryDeflater::~EntryDeflater() {
+    // Entries handed to the pool refer to the deflater until they are done
+    std::unique_lock<std::mutex> lock(this->mutex);
+    for (size_t i = 0; i < this->queued; i++) {
+        Entry &entry = this->entries[i];
+        this->block_ready.wait(lock, [&entry] { return entry.done; });
+    }
+}
+
+size_t duckx::EntryDeflater::add(const std::vector<char> &data) {
+    Entry entry;
+    entry.data = &data;
+    entry.index = -1;
+    entry.done = false;
+    entry.ok = false;
+    this->entries.push_back(entry);
+    return this->entries.size() - 1;
+}
+
+size_t duckx::EntryDeflater::add(int index) {
+    Entry entry;
+    entry.data = NULL;
+    entry.index = index;
+    entry.done = false;
+    entry.ok = false;
+    this->entries.push_back(entry);
+    return this->entries.size() - 1;
+}
+
+void duckx::EntryDeflater::start() { this->queue(this->pool.size()); }
+
+// Hand the entries before end to the pool. Their blocks wait in memory
+// until the entry is written, so only a few are compressed ahead.
+void duckx::EntryDeflater::queue(size_t end) {
+    if (!this->pool.size())
+        return;
+    end = std::min(end, this->entries.size());
+
+    for (; this->queued < end; this->queued++) {
+        Entry *entry = &this->entries[this->queued];
+        this->pool.run([this, entry](DeflatePool::Scratch &scratch) {
+            bool ok = this->compress(*entry, scratch, [this, entry](Block &block) {
+                {
+                    std::lock_guard<std::mutex> lock(this->mutex);
+                    entry->blocks.push_back(Block());
+                    entry->blocks.back().output.swap(block.output);
+                    entry->blocks.back().size = block.size;
+                    entry->blocks.back().crc = block.crc;
+                }
+                this->block_ready.notify_all();
+                return true;
+            });
+            // Notified under the lock, the deflater may be destroyed as
+            // soon as the entry is done
+            std::lock_guard<std::mutex> lock(this->mutex);
+            entry->ok = ok;
+            entry->done = true;
+            this->block_ready.notify_all();
+        });
+    }
+}
+
+// Deflate an entry as one stream, handing the output to put every time a
+// block of input has gone through. The output of a block may lag behind
+// its input; only the totals of the entry have to match.
+bool duckx::EntryDeflater::compress(Entry &entry,
+                                    DeflatePool::Scratch &scratch,
+                                    const std::function<bool(Block &)> &put) {
+    tdefl_compressor *comp = static_cast<tdefl_compressor *>(scratch.comp);
+    if (!comp)
+        return false;
+
+    zip_t *source = NULL;
+    if (!entry.data) {
+        source = this->pool.source(scratch);
+        if (!source || zip_entry_openbyindex(source, entry.index) != 0)
+            return false;
+    }
+
+    mz_uint flags = tdefl_create_comp_flags_from_zip_params(
+        this->level, -15, MZ_DEFAULT_STRATEGY);
+    Block block;
+    tdefl_init(comp, block_put_buf, &block.output, flags);
+
+    std::vector<char> chunk;
+    size_t offset = 0;
+    bool ok = true;
+    for (;;) {
+        // Next block of input, taken from the caller's bytes or inflated
+        // from the source a piece at a time
+        const char *data = NULL;
+        size_t size = 0;
+        if (entry.data) {
+            data = entry.data->data() + offset;
+            size = std::min(DEFLATE_BLOCK_SIZE, entry.data->size() - offset);
+            offset += size;
+        } else {
+            chunk.resize(DEFLATE_BLOCK_SIZE);
+            ssize_t n = zip_entry_readchunk(source, chunk.data(), chunk.size());
+            if (n < 0) {
+                ok = false;
+                break;
+            }
+            data = chunk.data();
+            size = static_cast<size_t>(n);
+        }
+
+        tdefl_status status = tdefl_compress_buffer(
+            comp, data, size, size ? TDEFL_NO_FLUSH : TDEFL_FINISH);
+        block.size = size;
+        block.crc = (unsigned int)mz_crc32(
+            MZ_CRC32_INIT, reinterpret_cast<const unsigned char *>(data),
+            size);
+        if (!size) {
+            ok = status == TDEFL_STATUS_DONE && put(block);
+            break;
+        }
+        if (status != TDEFL_STATUS_OKAY || !put(block)) {
+            ok = false;
+            break;
+        }
+        block.output.clear();
+    }
+
+    if (source)
+        zip_entry_close(source);
+    return ok;
+}
+
+bool duckx::EntryDeflater::write(size_t i, zip_t *zip, const char *name) {
+    Entry &entry = this->entries[i];
+    // Keep the pool busy with the entries that follow
+    this->queue(i + 1 + this->pool.size());
+
+    bool ok = zip_entry_open(zip, name) == 0;
+    if (!this->pool.size()) {
+        // Compress on this thread, writing each block as it comes
+        ok = ok && this->compress(entry, this->pool.scratch(),
+                                  [zip](Block &block) {
+                                      return zip_entry_write_deflated(
+                                                 zip, block.output.data(),
+                                                 block.output.size(),
+                                                 block.size, block.crc) == 0;
+                                  });
+    } else {
+        for (;;) {
+            Block block;
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->block_ready.wait(lock, [&entry] {
+                    return entry.done || !entry.blocks.empty();
+                });
+                if (entry.blocks.empty()) {
+                    ok = ok && entry.ok;
+                    break;
+                }
+                block.output.swap(entry.blocks.front().output);
+                block.size = entry.blocks.front().size;
+                block.crc = entry.blocks.front().crc;
+                entry.blocks.pop_front();
+            }
+            if (ok && zip_entry_write_deflated(zip, block.output.data(),
+                                               block.output.size(), block.size,
+                                               block.crc) != 0)
+                ok = false;
+        }
+    }
+    return zip_entry_close(zip) == 0 && ok;
+}
@@ -0,0 +1,164 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+#ifndef DUCKX_DEFLATE_HPP
+#define DUCKX_DEFLATE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pugixml/pugixml.hpp"
+#include "zip/zip.h"
+
+namespace duckx {
+// DeflatePool runs the compression jobs of one save on a fixed set of
+// threads, shared by the entries and the blocks of content.xml so that a
+// save never runs more threads than it was given. Each thread keeps its
+// compressor and, once a job asks for it, a reader on the source package.
+// Jobs run in the order they are queued and must not wait for each other.
+// The threads are started by the first job.
+class DeflatePool {
+  public:
+    // State a job may use on the thread running it
+    struct Scratch {
+        // tdefl_compressor
+        void *comp;
+        zip_t *source;
+    };
+    typedef std::function<void(Scratch &)> Job;
+
+  private:
+    // Opens a reader on the source package
+    std::function<zip_t *()> open_source;
+    unsigned threads;
+    bool stopping;
+    // Scratch of the calling thread, for jobs run without the pool
+    Scratch own;
+
+    std::deque<Job> jobs;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable job_ready;
+
+    void work();
+
+  public:
+    DeflatePool(unsigned threads, std::function<zip_t *()> open_source);
+    ~DeflatePool();
+    DeflatePool(const DeflatePool &) = delete;
+    DeflatePool &operator=(const DeflatePool &) = delete;
+
+    // Number of threads, 0 when the caller compresses everything itself
+    unsigned size() const;
+    void run(Job job);
+    // Scratch for work done on the calling thread
+    Scratch &scratch();
+    // Reader on the source package for the scratch, opened on first use
+    zip_t *source(Scratch &);
+};
+
+// ParallelDeflateWriter deflates pugixml output on a pool of threads,
+// in the style of pigz.
+// The output is cut in fixed-size blocks, every block is compressed on its
+// own and ends with a sync flush, so the blocks can be written one after
+// the other as a single deflate stream. The crc-32 of each block is
+// computed by the same thread and combined when the block is written.
+class ParallelDeflateWriter : public pugi::xml_writer {
+  private:
+    struct Block {
+        std::vector<char> input;
+        std::vector<char> output;
+        unsigned int crc;
+        bool done;
+    };
+
+    zip_t *zip;
+    DeflatePool &pool;
+    int level;
+    size_t block_size;
+    size_t max_blocks;
+    bool failed;
+
+    std::unique_ptr<Block> current;
+    // Blocks in stream order, written from the front once compressed
+    std::deque<std::unique_ptr<Block> > blocks;
+
+    std::mutex mutex;
+    std::condition_variable block_done;
+
+    void submit();
+    void flush(bool wait);
+    void compress(Block &, DeflatePool::Scratch &);
+
+  public:
+    ParallelDeflateWriter(zip_t *zip, DeflatePool &pool, int level);
+    ~ParallelDeflateWriter();
+
+    virtual void write(const void *data, size_t size);
+
+    // Compress the remaining output, write every block and end the stream
+    bool finish();
+};
+
+// EntryDeflater compresses whole package entries on a pool of threads.
+// Each entry is compressed by one thread as a single deflate stream, cut
+// in blocks as the input goes through. The caller writes the entries one
+// after the other with write(), which writes the blocks of the entry as
+// soon as they are compressed, so the archive and its central directory
+// are still written sequentially. Only a few entries are compressed ahead
+// of the one being written. Without threads, entries are compressed inside
+// write().
+class EntryDeflater {
+  private:
+    struct Block {
+        std::vector<char> output;
+        size_t size;
+        unsigned int crc;
+    };
+    struct Entry {
+        // Bytes to compress, or NULL to inflate `index` from the source
+        const std::vector<char> *data;
+        int index;
+        // Blocks compressed but not written yet
+        std::deque<Block> blocks;
+        bool done;
+        bool ok;
+    };
+
+    DeflatePool &pool;
+    int level;
+    std::vector<Entry> entries;
+    // Entries handed to the pool so far
+    size_t queued;
+
+    std::mutex mutex;
+    std::condition_variable block_ready;
+
+    void queue(size_t end);
+    bool compress(Entry &, DeflatePool::Scratch &,
+                  const std::function<bool(Block &)> &put);
+
+  public:
+    EntryDeflater(DeflatePool &pool, int level);
+    ~EntryDeflater();
+
+    // Queue bytes owned by the caller, they must outlive the deflater
+    size_t add(const std::vector<char> &data);
+    // Queue an entry of the source package
+    size_t add(int index);
+    // Start compressing, no entry can be added afterwards
+    void start();
+    // Write an entry to zip under the given name as it is compressed
+    bool write(size_t, zip_t *zip, const char *name);
+};
+} // namespace duckx
+
+#endif
@@ -1,249 +1,665 @@
 #include "duckx.hpp"
+#include "deflate.hpp"
+#include <algorithm>
 #include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+// Number of threads to use for the given option
+static unsigned save_threads(unsigned threads) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    return threads;
+}
+
+// Grow a std::vector<char> as the zip writer asks for it
+static size_t vector_write(void *arg, unsigned long long offset,
+                           const void *data, size_t size) {
+    std::vector<char> *out = static_cast<std::vector<char> *>(arg);
+    if (out->size() < offset + size)
+        out->resize(offset + size);
+    memcpy(&(*out)[offset], data, size);
+    return size;
+}
+
+// Parse an xml entry of the package into document
+static bool load_entry(zip_t *zip, const char *name,
+                       pugi::xml_document &document, std::vector<char> &text) {
+    bool loaded = false;
+
+    if (zip_entry_open(zip, name) == 0) {
+        // Inflate straight into the buffer kept with the document and parse
+        // it in place, so the buffer becomes the string storage of the DOM
+        // instead of being copied once more. The buffer keeps its capacity
+        // for the next package.
+        size_t bufsize = (size_t)zip_entry_size(zip);
+        text.resize(bufsize ? bufsize : 1);
+
+        // Whitespace between elements is kept, since it is text in ODF
+        // paragraphs, e.g. the space between two spans
+        if (zip_entry_noallocread(zip, text.data(), bufsize) >= 0)
+            loaded = document.load_buffer_inplace(
+                text.data(), bufsize,
+                pugi::parse_default | pugi::parse_ws_pcdata);
+    }
+
+    zip_entry_close(zip);
+    return loaded;
+}
+
+// Entries are printed without indentation: whitespace is text in ODF
+// paragraphs, and is kept when they are parsed again
+static const unsigned print_flags = pugi::format_raw;
 
 // Hack on pugixml
-// We need to write xml to std string (or char *)
-// So overload the write function
-struct xml_string_writer : pugi::xml_writer {
-    std::string result;
+// We need to write xml straight into a zip entry
+// So overload the write function; pugixml hands over its output in
+// small blocks, which are deflated as they arrive
+struct xml_zip_writer : pugi::xml_writer {
+    zip_t *zip;
+
+    explicit xml_zip_writer(zip_t *zip) : zip(zip) {}
 
     virtual void write(const void *data, size_t size) {
-        result.append(static_cast<const char *>(data), size);
+        zip_entry_write(zip, data, size);
     }
 };
 
-duckx::Run::Run() {}
+// Record a modification of content.xml
+static void touch(duckx::Context *context) {
+    if (context)
+        context->touch();
+}
+
+// Names used for documents without a context, and for comparing
+// elements without a kind
+static const duckx::Names default_names;
+
+static const duckx::Names &names(const duckx::Context *context) {
+    return context ? context->names : default_names;
+}
+
+// Take the prefixes of content.xml from its root, and declare the ones
+// attributes added to it would lack
+static void bind_names(pugi::xml_node node, duckx::Names &names) {
+    pugi::xml_node root = node.first_child();
+    while (root && root.type() != pugi::node_element)
+        root = root.next_sibling();
+
+    names.reset();
+    for (pugi::xml_attribute attribute = root.first_attribute(); attribute;
+         attribute = attribute.next_attribute())
+        names.bind(attribute.name(), attribute.value());
+
+    // Attributes added to the document need a prefix for each namespace
+    std::vector<std::pair<std::string, std::string> > declarations =
+        names.declare();
+    for (size_t i = 0; i < declarations.size(); i++)
+        root.append_attribute(declarations[i].first.c_str())
+            .set_value(declarations[i].second.c_str());
+}
+
+// Set the kind of every element, with the prefixes of the document
+static void classify_tree(pugi::xml_node node, duckx::Names &names) {
+    bind_names(node, names);
+
+    pugi::xml_node child = node.first_child();
+    while (child) {
+        if (child.type() == pugi::node_element)
+            child.set_kind(static_cast<unsigned>(names.classify(child.name())));
+
+        if (child.first_child()) {
+            child = child.first_child();
+            continue;
+        }
+        while (child != node && !child.next_sibling())
+            child = child.parent();
+        if (child == node)
+            break;
+        child = child.next_sibling();
+    }
+}
+
+// Nodes without a kind (e.g. with PUGIXML_COMPACT) are compared by name,
+// with the usual prefixes
+static bool is_element(pugi::xml_node node, duckx::element kind) {
+    unsigned node_kind = node.kind();
+    if (node_kind)
+        return node_kind == static_cast<unsigned>(kind);
+    return node.type() == pugi::node_element &&
+           strcmp(node.name(), default_names.name(kind)) == 0;
+}
+
+static pugi::xml_node first_child(pugi::xml_node node, duckx::element kind) {
+    pugi::xml_node child = node.first_child();
+    while (child && !is_element(child, kind))
+        child = child.next_sibling();
+    return child;
+}
+
+static pugi::xml_node next_sibling(pugi::xml_node node, duckx::element kind) {
+    pugi::xml_node sibling = node.next_sibling();
+    while (sibling && !is_element(sibling, kind))
+        sibling = sibling.next_sibling();
+    return sibling;
+}
+
+static pugi::xml_node append_element(const duckx::Context *context,
+                                     pugi::xml_node node,
+                                     duckx::element kind) {
+    pugi::xml_node child = node.append_child(names(context).name(kind));
+    child.set_kind(static_cast<unsigned>(kind));
+    return child;
+}
+
+// Elements the handles do not step through
+static pugi::xml_node append_element(const duckx::Context *context,
+                                     pugi::xml_node node, duckx::xmlns space,
+                                     const char *local) {
+    pugi::xml_node child =
+        node.append_child(names(context).qualify(space, local).c_str());
+    child.set_kind(static_cast<unsigned>(duckx::element::other));
+    return child;
+}
+
+static std::string attribute(const duckx::Context *context,
+                             duckx::xmlns space, const char *local) {
+    return names(context).attribute(space, local);
+}
+
+const std::vector<pugi::xml_node> &
+duckx::Context::children(pugi::xml_node parent, element kind) const {
+    std::vector<Children> &lists = this->index[parent.internal_object()];
+    for (size_t i = 0; i < lists.size(); i++)
+        if (lists[i].kind == kind)
+            return lists[i].nodes;
+
+    Children list;
+    list.kind = kind;
+    for (pugi::xml_node child = first_child(parent, kind); child;
+         child = next_sibling(child, kind))
+        list.nodes.push_back(child);
+    lists.push_back(list);
+    return lists.back().nodes;
+}
+
+void duckx::Context::appended(pugi::xml_node parent, element kind,
+                              pugi::xml_node child) {
+    this->structure++;
+    std::unordered_map<pugi::xml_node_struct *,
+                       std::vector<Children> >::iterator it =
+        this->index.find(parent.internal_object());
+    if (it == this->index.end())
+        return;
+    for (size_t i = 0; i < it->second.size(); i++)
+        if (it->second[i].kind == kind)
+            it->second[i].nodes.push_back(child);
+}
+
+void duckx::Context::inserted(pugi::xml_node parent) {
+    this->structure++;
+    // Built again when asked for
+    this->index.erase(parent.internal_object());
+}
+
+void duckx::Context::removed() {
+    this->structure++;
+    // The memory of the removed nodes may be given to new ones, so no list
+    // of their children can be kept
+    this->index.clear();
+}
+
+// Child of parent at a position, looked up in the index of the context
+static pugi::xml_node child_at(const duckx::Context *context,
+                               pugi::xml_node parent, duckx::element kind,
+                               size_t position) {
+    if (!parent)
+        return pugi::xml_node();
+
+    if (context) {
+        const std::vector<pugi::xml_node> &nodes =
+            context->children(parent, kind);
+        return position < nodes.size() ? nodes[position] : pugi::xml_node();
+    }
 
-duckx::Run::Run(pugi::xml_node parent, pugi::xml_node current) {
-    this->set_parent(parent);
-    this->set_current(current);
+    pugi::xml_node child = first_child(parent, kind);
+    for (; child && position; position--)
+        child = next_sibling(child, kind);
+    return child;
 }
 
+static size_t child_count(const duckx::Context *context,
+                          pugi::xml_node parent, duckx::element kind) {
+    if (!parent)
+        return 0;
+    if (context)
+        return context->children(parent, kind).size();
+
+    size_t count = 0;
+    for (pugi::xml_node child = first_child(parent, kind); child;
+         child = next_sibling(child, kind))
+        count++;
+    return count;
+}
+
+// Copy the bytes of a file, for packages saved without changes
+static bool copy_file(const std::string &from, const std::string &to) {
+    FILE *in = fopen(from.c_str(), "rb");
+    if (!in)
+        return false;
+    FILE *out = fopen(to.c_str(), "wb");
+    if (!out) {
+        fclose(in);
+        return false;
+    }
+
+    char chunk[65536];
+    bool ok = true;
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        if (fwrite(chunk, 1, n, out) != n) {
+            ok = false;
+            break;
+        }
+    }
+    if (ferror(in))
+        ok = false;
+
+    fclose(in);
+    if (fclose(out) != 0)
+        ok = false;
+    return ok;
+}
+
+static bool read_file(const std::string &name, std::vector<char> &out) {
+    FILE *in = fopen(name.c_str(), "rb");
+    if (!in)
+        return false;
+
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0)
+        out.insert(out.end(), chunk, chunk + n);
+    bool ok = !ferror(in);
+
+    fclose(in);
+    return ok;
+}
+
+// Hand the bytes of a file to a Writer in chunks
+static bool write_file(const std::string &name, duckx::Writer &writer) {
+    FILE *in = fopen(name.c_str(), "rb");
+    if (!in)
+        return false;
+
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0)
+        writer.write(chunk, n);
+    bool ok = !ferror(in);
+
+    fclose(in);
+    return ok;
+}
+
+// Pass the package to a Writer as the zip writer produces it. The local
+// header of an entry is written again when the entry is closed, so the
+// bytes of the open entry are held back until then; bytes written while
+// no entry is open, such as copied entries and the central directory, are
+// final as they come.
+struct zip_stream_writer {
+    duckx::Writer &writer;
+    zip_t *zip;
+    std::vector<char> pending;
+    // Offset of the first byte of pending in the package
+    unsigned long long flushed;
+
+    explicit zip_stream_writer(duckx::Writer &writer)
+        : writer(writer), zip(NULL), flushed(0) {}
+
+    void flush() {
+        if (!this->pending.empty())
+            this->writer.write(this->pending.data(), this->pending.size());
+        this->flushed += this->pending.size();
+        this->pending.clear();
+    }
+
+    static size_t write(void *arg, unsigned long long offset, const void *data,
+                        size_t size) {
+        zip_stream_writer *self = static_cast<zip_stream_writer *>(arg);
+        // Bytes already handed out cannot be changed any more
+        if (offset < self->flushed)
+            return 0;
+
+        size_t at = static_cast<size_t>(offset - self->flushed);
+        bool rewrite = at + size <= self->pending.size();
+        if (!rewrite)
+            self->pending.resize(at + size);
+        memcpy(&self->pending[at], data, size);
+
+        // Rewriting the local header is the last step of closing an entry
+        if (rewrite || !zip_entry_name(self->zip))
+            self->flush();
+        return size;
+    }
+};
+
+// Collect pugixml output in a vector, for parts compressed by the pool
+struct xml_vector_writer : pugi::xml_writer {
+    std::vector<char> &result;
+
+    explicit xml_vector_writer(std::vector<char> &result) : result(result) {}
+
+    virtual void write(const void *data, size_t size) {
+        const char *bytes = static_cast<const char *>(data);
+        result.insert(result.end(), bytes, bytes + size);
+    }
+};
+
+duckx::Run::Run() : context(NULL) {}
+
+duckx::Run::Run(pugi::xml_node parent, pugi::xml_node current)
+    : parent(parent), current(current), context(NULL) {}
+
 void duckx::Run::set_parent(pugi::xml_node node) {
     this->parent = node;
-    this->current = this->parent.child("text:span");
+    this->current = first_child(this->parent, element::span);
 }
 
 void duckx::Run::set_current(pugi::xml_node node) { this->current = node; }
 
+void duckx::Run::set_context(Context *context) { this->context = context; }
+
 std::string duckx::Run::get_text() const {
     return this->current.text().get();
 }
 
 bool duckx::Run::set_text(const std::string &text) const {
-    return this->current.text().set(text.c_str());
+    return this->set_text(text.c_str());
 }
 
 bool duckx::Run::set_text(const char *text) const {
+    touch(this->context);
     return this->current.text().set(text);
 }
 
 duckx::Run &duckx::Run::next() {
-    this->current = this->current.next_sibling("text:span");
+    this->current = next_sibling(this->current, element::span);
     return *this;
 }
 
 bool duckx::Run::has_next() const { return this->current != 0; }
 
 // Table cells
-duckx::TableCell::TableCell() {}
+duckx::TableCell::TableCell() : context(NULL) {}
 
-duckx::TableCell::TableCell(pugi::xml_node parent, pugi::xml_node current) {
-    this->set_parent(parent);
-    this->set_current(current);
-}
+duckx::TableCell::TableCell(pugi::xml_node parent, pugi::xml_node current)
+    : parent(parent), current(current), context(NULL) {}
 
 void duckx::TableCell::set_parent(pugi::xml_node node) {
     this->parent = node;
-    this->current = this->parent.child("table:table-cell");
-    this->paragraph.set_parent(this->current);
+    this->current = first_child(this->parent, element::table_cell);
 }
 
 void duckx::TableCell::set_current(pugi::xml_node node) {
     this->current = node;
 }
 
+void duckx::TableCell::set_context(Context *context) {
+    this->context = context;
+}
+
 bool duckx::TableCell::has_next() const { return this->current != 0; }
 
-duckx::Paragraph& duckx::TableCell::add_paragraph(const std::string& text)
+duckx::Paragraph duckx::TableCell::add_paragraph(const std::string& text)
 {
     pugi::xml_node new_para =
-        this->current.append_child("text:p");
-
-    Paragraph* p = new Paragraph();
-    p->set_current(new_para);
+        append_element(this->context, this->current, element::paragraph);
+    touch(this->context);
+    if (this->context)
+        this->context->appended(this->current, element::paragraph, new_para);
+
+    Paragraph p;
+    p.set_context(this->context);
+    p.set_current(new_para);
     if (text.size() != 0)
-        p->add_run(text);
+        p.add_run(text);
 
-    return *p;
+    return p;
 }
 
 duckx::TableCell &duckx::TableCell::next() {
-    this->current = this->current.next_sibling("table:table-cell");
+    this->current = next_sibling(this->current, element::table_cell);
     return *this;
 }
 
-duckx::Paragraph &duckx::TableCell::paragraphs() {
-    this->paragraph.set_parent(this->current);
-    return this->paragraph;
+duckx::Paragraph duckx::TableCell::paragraphs() const {
+    Paragraph p;
+    p.set_parent(this->current);
+    p.set_context(this->context);
+    return p;
 }
 
 // Table rows
-duckx::TableRow::TableRow() {}
+duckx::TableRow::TableRow() : context(NULL) {}
 
-duckx::TableRow::TableRow(pugi::xml_node parent, pugi::xml_node current) {
-    this->set_parent(parent);
-    this->set_current(current);
-}
+duckx::TableRow::TableRow(pugi::xml_node parent, pugi::xml_node current)
+    : parent(parent), current(current), context(NULL) {}
 
 void duckx::TableRow::set_parent(pugi::xml_node node) {
     this->parent = node;
-    this->current = this->parent.child("table:table-row");
-    this->cell.set_parent(this->current);
+    this->current = first_child(this->parent, element::table_row);
 }
 
 void duckx::TableRow::set_current(pugi::xml_node node) { this->current = node; }
 
+void duckx::TableRow::set_context(Context *context) {
+    this->context = context;
+}
+
+void duckx::TableRow::delete_row() {
+    touch(this->context);
+    if (this->context)
+        this->context->removed();
+    this->parent.remove_child(this->current);
+}
+
 duckx::TableRow &duckx::TableRow::next() {
-    this->current = this->current.next_sibling("table:table-row");
+    this->current = next_sibling(this->current, element::table_row);
     return *this;
 }
 
-duckx::TableCell &duckx::TableRow::cells() {
-    this->cell.set_parent(this->current);
-    return this->cell;
+duckx::TableCell duckx::TableRow::cells() const {
+    TableCell c;
+    c.set_parent(this->current);
+    c.set_context(this->context);
+    return c;
 }
 
-duckx::TableCell& duckx::TableRow::add_cell(const std::string& cellstyle, const std::string& parstyle)
+duckx::TableCell duckx::TableRow::add_cell(const std::string& cellstyle, const std::string& parstyle)
 {
     // Add new run
-    pugi::xml_node new_cell = this->current.append_child("table:table-cell");
-    new_cell.append_attribute("table:style-name").set_value(cellstyle.c_str());
-    new_cell.append_child("text:p").append_attribute("text:style-name").set_value(parstyle.c_str());
-
-    return *new TableCell(this->current, new_cell);
+    pugi::xml_node new_cell = append_element(this->context, this->current, element::table_cell);
+    new_cell.append_attribute(attribute(this->context, xmlns::table, "style-name").c_str()).set_value(cellstyle.c_str());
+    append_element(this->context, new_cell, element::paragraph).append_attribute(attribute(this->context, xmlns::text, "style-name").c_str()).set_value(parstyle.c_str());
+    touch(this->context);
+    if (this->context)
+        this->context->appended(this->current, element::table_cell, new_cell);
+
+    TableCell c(this->current, new_cell);
+    c.set_context(this->context);
+    return c;
 }
 
-duckx::TableCell& duckx::TableRow::add_cell(const std::string& cellstyle)
+duckx::TableCell duckx::TableRow::add_cell(const std::string& cellstyle)
 {
     // Add new run
-    pugi::xml_node new_cell = this->current.append_child("table:table-cell");
-    new_cell.append_attribute("table:style-name").set_value(cellstyle.c_str());
-
-    return *new TableCell(this->current, new_cell);
+    pugi::xml_node new_cell = append_element(this->context, this->current, element::table_cell);
+    new_cell.append_attribute(attribute(this->context, xmlns::table, "style-name").c_str()).set_value(cellstyle.c_str());
+    touch(this->context);
+    if (this->context)
+        this->context->appended(this->current, element::table_cell, new_cell);
+
+    TableCell c(this->current, new_cell);
+    c.set_context(this->context);
+    return c;
 }
 
 void duckx::TableRow::add_covered_cell()
 {
     //pugi::xml_node new_cell = 
-        this->current.append_child("table:covered-table-cell");
-    //return *new TableCell(this->current, new_cell);
+        append_element(this->context, this->current, element::covered_table_cell);
+    touch(this->context);
 }
 
-duckx::TableCell& duckx::TableRow::add_united_cell(const std::string& cellstyle, const std::string& parstyle, const int united_cell_columns, const int united_cell_rows)
+duckx::TableCell duckx::TableRow::add_united_cell(const std::string& cellstyle, const std::string& parstyle, const int united_cell_columns, const int united_cell_rows)
 {
-    pugi::xml_node new_cell = this->current.append_child("table:table-cell");
-    new_cell.append_attribute("table:style-name").set_value(cellstyle.c_str());
-    new_cell.append_attribute("table:number-columns-spanned").set_value(united_cell_columns);
+    pugi::xml_node new_cell = append_element(this->context, this->current, element::table_cell);
+    new_cell.append_attribute(attribute(this->context, xmlns::table, "style-name").c_str()).set_value(cellstyle.c_str());
+    new_cell.append_attribute(attribute(this->context, xmlns::table, "number-columns-spanned").c_str()).set_value(united_cell_columns);
     if (united_cell_rows > 1)
-        new_cell.append_attribute("table:number-rows-spanned").set_value(united_cell_rows);
-    new_cell.append_child("text:p").append_attribute("text:style-name").set_value(parstyle.c_str());
+        new_cell.append_attribute(attribute(this->context, xmlns::table, "number-rows-spanned").c_str()).set_value(united_cell_rows);
+    append_element(this->context, new_cell, element::paragraph).append_attribute(attribute(this->context, xmlns::text, "style-name").c_str()).set_value(parstyle.c_str());
     for (int i = 1; i < united_cell_columns; i++)
-        this->current.append_child("table:covered-table-cell");
-    
-    return *new TableCell(this->current, new_cell);
+        append_element(this->context, this->current, element::covered_table_cell);
+    touch(this->context);
+    if (this->context)
+        this->context->appended(this->current, element::table_cell, new_cell);
+
+    TableCell c(this->current, new_cell);
+    c.set_context(this->context);
+    return c;
 }
 
 bool duckx::TableRow::has_next() const { return this->current != 0; }
 
-// Tables
-duckx::Table::Table() {}
+duckx::TableCell duckx::TableRow::cell_at(size_t position) const {
+    TableCell c(this->current, child_at(this->context, this->current,
+                                        element::table_cell, position));
+    c.set_context(this->context);
+    return c;
+}
 
-duckx::Table::Table(pugi::xml_node parent, pugi::xml_node current) {
-    this->set_parent(parent);
-    this->set_current(current);
+size_t duckx::TableRow::cell_count() const {
+    return child_count(this->context, this->current, element::table_cell);
 }
 
+// Tables
+duckx::Table::Table() : context(NULL) {}
+
+duckx::Table::Table(pugi::xml_node parent, pugi::xml_node current)
+    : parent(parent), current(current), context(NULL) {}
+
 void duckx::Table::set_parent(pugi::xml_node node) {
     this->parent = node;
-    this->current = this->parent.child("table:table");
-    this->row.set_parent(this->current);
+    this->current = first_child(this->parent, element::table);
 }
 
 bool duckx::Table::has_next() const { return this->current != 0; }
 
 duckx::Table &duckx::Table::next() {
-    this->current = this->current.next_sibling("table:table");
-    this->row.set_parent(this->current);
+    this->current = next_sibling(this->current, element::table);
     return *this;
 }
 
 void duckx::Table::set_current(pugi::xml_node node) { this->current = node; }
 
-duckx::TableRow &duckx::Table::rows() {
-    this->row.set_parent(this->current);
-    return this->row;
+void duckx::Table::set_context(Context *context) {
+    this->context = context;
 }
 
-duckx::TableRow& duckx::Table::add_row(const std::string& stylename)
+duckx::TableRow duckx::Table::rows() const {
+    TableRow r;
+    r.set_parent(this->current);
+    r.set_context(this->context);
+    return r;
+}
+
+duckx::TableRow duckx::Table::add_row(const std::string& stylename)
 {
     // Add new run
-    pugi::xml_node new_row = this->current.append_child("table:table-row");
-    new_row.append_attribute("table:style-name").set_value(stylename.c_str());
+    pugi::xml_node new_row = append_element(this->context, this->current, element::table_row);
+    new_row.append_attribute(attribute(this->context, xmlns::table, "style-name").c_str()).set_value(stylename.c_str());
+    touch(this->context);
+    if (this->context)
+        this->context->appended(this->current, element::table_row, new_row);
+
+    TableRow r(this->current, new_row);
+    r.set_context(this->context);
+    return r;
+}
+
+duckx::TableRow duckx::Table::row_at(size_t position) const {
+    TableRow r(this->current, child_at(this->context, this->current,
+                                       element::table_row, position));
+    r.set_context(this->context);
+    return r;
+}
 
-    return *new TableRow(this->current, new_row);
+size_t duckx::Table::row_count() const {
+    return child_count(this->context, this->current, element::table_row);
 }
 
 void duckx::Table::add_column(const std::vector<std::string>& stylenames)
 {
-    pugi::xml_node new_cols = this->current.append_child("table:table-columns");
+    pugi::xml_node new_cols = append_element(this->context, this->current, xmlns::table, "table-columns");
+    touch(this->context);
     for (auto elem : stylenames)
-        new_cols.append_child("table:table-column").append_attribute("table:style-name").set_value(elem.c_str());
+        append_element(this->context, new_cols, xmlns::table, "table-column").append_attribute(attribute(this->context, xmlns::table, "style-name").c_str()).set_value(elem.c_str());
 }
 
 
-duckx::Paragraph::Paragraph() {}
+duckx::Paragraph::Paragraph() : context(NULL) {}
 
-duckx::Paragraph::Paragraph(pugi::xml_node parent, pugi::xml_node current) {
-    this->set_parent(parent);
-    this->set_current(current);
-}
+duckx::Paragraph::Paragraph(pugi::xml_node parent, pugi::xml_node current)
+    : parent(parent), current(current), context(NULL) {}
 
 void duckx::Paragraph::set_parent(pugi::xml_node node) {
     this->parent = node;
-    this->current = this->parent.child("text:p");
-
-    this->run.set_parent(this->current);
+    this->current = first_child(this->parent, element::paragraph);
 }
 
 void duckx::Paragraph::set_current(pugi::xml_node node) {
     this->current = node;
 }
 
+void duckx::Paragraph::set_context(Context *context) {
+    this->context = context;
+}
+
+void duckx::Paragraph::delete_par() {
+    touch(this->context);
+    if (this->context)
+        this->context->removed();
+    this->parent.remove_child(this->current);
+}
+
 duckx::Paragraph &duckx::Paragraph::next() {
-    this->current = this->current.next_sibling("text:p");
-    this->run.set_parent(this->current);
+    this->current = next_sibling(this->current, element::paragraph);
     return *this;
 }
 
 bool duckx::Paragraph::has_next() const { return this->current != 0; }
 
-duckx::Run &duckx::Paragraph::runs() {
-    this->run.set_parent(this->current);
-    return this->run;
+duckx::Run duckx::Paragraph::runs() const {
+    Run r;
+    r.set_parent(this->current);
+    r.set_context(this->context);
+    return r;
 }
 
-duckx::Run &duckx::Paragraph::add_run(const std::string &text,
+duckx::Run duckx::Paragraph::add_run(const std::string &text,
     std::string stylename) {
     return this->add_run(text.c_str(), stylename.c_str());
 }
 
-duckx::Run &duckx::Paragraph::add_run(const char *text,
+duckx::Run duckx::Paragraph::add_run(const char *text,
     const char* stylename) {
     // Add new run
-    pugi::xml_node new_run = this->current.append_child("text:span");
+    pugi::xml_node new_run = append_element(this->context, this->current, element::span);
     //// Insert meta to new run
-    new_run.append_attribute("text:style-name").set_value(stylename);
+    new_run.append_attribute(attribute(this->context, xmlns::text, "style-name").c_str()).set_value(stylename);
     
     // If the run starts or ends with whitespace characters, preserve them using
     // the xml:space attribute
@@ -251,163 +667,706 @@ duckx::Run &duckx::Paragraph::add_run(const char *text,
     //    new_run.append_attribute("xml:space").set_value("preserve");
     //new_run_text.text().set(text);
     new_run.text().set(text);
-    return *new Run(this->current, new_run);
+    touch(this->context);
+
+    Run r(this->current, new_run);
+    r.set_context(this->context);
+    return r;
 }
 
-duckx::Paragraph &
+duckx::Paragraph
 duckx::Paragraph::insert_paragraph_after(const std::string &text,
                                          std::string stylename) {
 
     pugi::xml_node new_para =
-        this->parent.insert_child_after("text:p", this->current);
-
-    Paragraph *p = new Paragraph();
-    p->set_current(new_para);
+        this->parent.insert_child_after(
+            names(this->context).name(element::paragraph), this->current);
+    new_para.set_kind(static_cast<unsigned>(element::paragraph));
+    touch(this->context);
+    if (this->context)
+        this->context->inserted(this->parent);
+
+    Paragraph p;
+    p.set_context(this->context);
+    p.set_current(new_para);
     if (text.size() != 0)
-        p->add_run(text, stylename);
+        p.add_run(text, stylename);
 
-    return *p;
+    return p;
 }
 
 void duckx::Paragraph::add_image(const std::string& name, const std::string& width/* = ""*/, const std::string& height/* = ""*/)
 {
     pugi::xml_node new_frame =
-        this->current.append_child("draw:frame");
+        append_element(this->context, this->current, xmlns::draw, "frame");
+    touch(this->context);
     //new_frame.append_attribute("draw:style-name").set_value("a0");
-    new_frame.append_attribute("text:anchor-type").set_value("as-char");
+    new_frame.append_attribute(attribute(this->context, xmlns::text, "anchor-type").c_str()).set_value("as-char");
     if (width.size() > 0)
     {
-        new_frame.append_attribute("svg:width").set_value(width.c_str());
+        new_frame.append_attribute(attribute(this->context, xmlns::svg, "width").c_str()).set_value(width.c_str());
         if (height.size() > 0)
-            new_frame.append_attribute("svg:height").set_value(height.c_str());
+            new_frame.append_attribute(attribute(this->context, xmlns::svg, "height").c_str()).set_value(height.c_str());
         else
-            new_frame.append_attribute("svg:height").set_value(width.c_str());
+            new_frame.append_attribute(attribute(this->context, xmlns::svg, "height").c_str()).set_value(width.c_str());
     }
     else
     {
-        new_frame.append_attribute("svg:width").set_value("2.70833in");
-        new_frame.append_attribute("svg:height").set_value("1.35833in");
+        new_frame.append_attribute(attribute(this->context, xmlns::svg, "width").c_str()).set_value("2.70833in");
+        new_frame.append_attribute(attribute(this->context, xmlns::svg, "height").c_str()).set_value("1.35833in");
     }
-    new_frame.append_attribute("style:rel-width").set_value("scale");
-    new_frame.append_attribute("style:rel-height").set_value("scale");
+    new_frame.append_attribute(attribute(this->context, xmlns::style, "rel-width").c_str()).set_value("scale");
+    new_frame.append_attribute(attribute(this->context, xmlns::style, "rel-height").c_str()).set_value("scale");
 
-    pugi::xml_node new_image = new_frame.append_child("draw:image");
-    new_image.append_attribute("xlink:href").set_value(std::string("media/").append(name).c_str());
+    pugi::xml_node new_image = append_element(this->context, new_frame, xmlns::draw, "image");
+    new_image.append_attribute(attribute(this->context, xmlns::xlink, "href").c_str()).set_value(std::string("media/").append(name).c_str());
 
 
 }
 
 void duckx::Paragraph::set_style(const std::string& name)
 {
-    current.attribute("text:style-name").set_value(name.c_str());
+    touch(this->context);
+    current.attribute(attribute(this->context, xmlns::text, "style-name").c_str()).set_value(name.c_str());
 }
 
-duckx::Document::Document() {
+duckx::Document::Document()
+    : arena(new Arena()), reader(NULL), reader_ready(false),
+      context(new Context()), saved_revision(0), block_structure(0) {
     // TODO: this function must be removed!
     this->directory = "";
+    this->document.set_memory_resource(this->arena.get());
+    this->paragraph.set_context(this->context.get());
+    this->table.set_context(this->context.get());
+    this->style.set_context(this->context.get());
 }
 
-duckx::Document::Document(std::string directory) {
+duckx::Document::Document(std::string directory)
+    : arena(new Arena()), reader(NULL), reader_ready(false),
+      context(new Context()), saved_revision(0), block_structure(0) {
     this->directory = directory;
+    this->document.set_memory_resource(this->arena.get());
+    this->paragraph.set_context(this->context.get());
+    this->table.set_context(this->context.get());
+    this->style.set_context(this->context.get());
+}
+
+duckx::Document::~Document() {
+    if (this->reader)
+        zip_close(this->reader);
+}
+
+duckx::Document::Document(Document &&other) : Document() {
+    *this = std::move(other);
+}
+
+duckx::Document &duckx::Document::operator=(Document &&other) {
+    if (this == &other)
+        return *this;
+
+    // Our pages go back to our arena before it is replaced; the pages
+    // moved in stay with the arena of the other document, which comes along
+    if (this->reader)
+        zip_close(this->reader);
+    this->reader = other.reader;
+    this->reader_ready = other.reader_ready;
+    other.reader = NULL;
+    other.reader_ready = false;
+
+    this->document = std::move(other.document);
+    this->parts = std::move(other.parts);
+    this->spare_parts = std::move(other.spare_parts);
+    this->arena = std::move(other.arena);
+    this->content_text = std::move(other.content_text);
+
+    // The reader may point into any of these
+    this->directory = std::move(other.directory);
+    this->buffer = std::move(other.buffer);
+    this->shared_package = std::move(other.shared_package);
+    this->mapping = std::move(other.mapping);
+
+    this->context = std::move(other.context);
+    this->paragraph = other.paragraph;
+    this->table = other.table;
+    this->style = other.style;
+    this->saved_revision = other.saved_revision;
+    this->block_list = std::move(other.block_list);
+    this->block_structure = other.block_structure;
+    this->options = other.options;
+    this->files = std::move(other.files);
+
+    // The other document starts over empty, with memory of its own
+    other.arena.reset(new Arena());
+    other.document.set_memory_resource(other.arena.get());
+    other.parts.clear();
+    other.spare_parts.clear();
+    other.content_text.clear();
+    other.directory.clear();
+    other.buffer.clear();
+    other.shared_package.reset();
+    other.context.reset(new Context());
+    other.paragraph = Paragraph();
+    other.table = Table();
+    other.style = Style();
+    other.paragraph.set_context(other.context.get());
+    other.table.set_context(other.context.get());
+    other.style.set_context(other.context.get());
+    other.saved_revision = 0;
+    other.block_list.clear();
+    other.block_structure = 0;
+    other.files.clear();
+    return *this;
 }
 
 void duckx::Document::file(std::string directory) {
+    this->release_package();
     this->directory = directory;
+    this->buffer.clear();
+    this->shared_package.reset();
+    this->mapping.unmap();
+}
+
+duckx::Span duckx::Document::package_bytes() const {
+    Span span = {NULL, 0};
+    if (this->mapping.data()) {
+        span.data = this->mapping.data();
+        span.size = this->mapping.size();
+    } else if (!this->buffer.empty()) {
+        span.data = this->buffer.data();
+        span.size = this->buffer.size();
+    } else if (this->shared_package) {
+        span.data = this->shared_package->data();
+        span.size = this->shared_package->size();
+    }
+    return span;
+}
+
+zip_t *duckx::Document::open_package() const {
+    Span bytes = this->package_bytes();
+    if (bytes.data)
+        return zip_stream_open(bytes.data, bytes.size,
+                               ZIP_DEFAULT_COMPRESSION_LEVEL, 'r');
+    return zip_open(this->directory.c_str(), ZIP_DEFAULT_COMPRESSION_LEVEL,
+                    'r');
+}
+
+zip_t *duckx::Document::package() const {
+    if (this->reader_ready)
+        return this->reader;
+
+    if (!this->reader) {
+        this->reader = this->open_package();
+    } else {
+        // Read the current package with the arrays of the previous one
+        Span bytes = this->package_bytes();
+        int status = bytes.data
+                         ? zip_stream_reopen(this->reader, bytes.data,
+                                             bytes.size)
+                         : zip_reopen(this->reader, this->directory.c_str());
+        if (status < 0) {
+            zip_close(this->reader);
+            this->reader = NULL;
+        }
+    }
+
+    this->reader_ready = this->reader != NULL;
+    return this->reader;
+}
+
+void duckx::Document::release_package() const {
+    if (this->reader)
+        zip_reopen(this->reader, NULL);
+    this->reader_ready = false;
+}
+
+void duckx::Document::clear_content() {
+    this->release_package();
+    this->files.clear();
+
+    // Parts give their pages back before the arena is reset, and are kept
+    // for their buffers
+    for (size_t i = 0; i < this->parts.size(); i++) {
+        this->parts[i]->document.reset();
+        this->spare_parts.push_back(std::move(this->parts[i]));
+    }
+    this->parts.clear();
+
+    // Nothing refers to the pages of the previous package any more, so the
+    // arena starts over in the blocks it already has
+    this->document.reset();
+    this->arena->reset();
+    this->context->index.clear();
+    this->context->names.reset();
+    this->context->structure++;
+
+    this->saved_revision = this->context->revision;
+}
+
+void duckx::Document::reset() {
+    this->clear_content();
+    this->buffer.clear();
+    this->shared_package.reset();
+    this->mapping.unmap();
+}
+
+void duckx::Document::reopen(const std::string &directory) {
+    this->file(directory);
+    this->open();
+}
+
+void duckx::Document::reopen(const void *data, size_t size) {
+    this->open_from_memory(data, size);
 }
 
 void duckx::Document::open() {
-    void *buf = NULL;
-    size_t bufsize;
+    this->clear_content();
 
     // Open file and load "xml" content to the document variable
-    zip_t *zip =
-        zip_open(this->directory.c_str(), ZIP_DEFAULT_COMPRESSION_LEVEL, 'r');
+    zip_t *zip = this->package();
+    if (!zip)
+        return;
 
     //zip_entry_open(zip, "word/document.xml");
-    zip_entry_open(zip, "content.xml");
-    zip_entry_read(zip, &buf, &bufsize);
+    if (load_entry(zip, "content.xml", this->document, this->content_text))
+        classify_tree(this->document, this->context->names);
 
-    zip_entry_close(zip);
-    zip_close(zip);
+    // Whatever was loaded is what the package holds
+    this->saved_revision = this->context->revision;
 
-    this->document.load_buffer(buf, bufsize);
+    //this->paragraph.set_parent(document.child("w:document").child("w:body"));
+    this->paragraph.set_parent(this->office_text());
+}
 
-    free(buf);
+void duckx::Document::open_from_memory(const void *data, size_t size) {
+    const char *bytes = static_cast<const char *>(data);
+    this->release_package();
+    this->mapping.unmap();
+    this->shared_package.reset();
+    // The package no longer comes from the file, so save() has nowhere to
+    // write it back to
+    this->directory = "";
+    this->buffer.assign(bytes, bytes + size);
+    this->open();
+}
 
-    //this->paragraph.set_parent(document.child("w:document").child("w:body"));
-    this->paragraph.set_parent(document.child("office::document-content").child("office:body").child("office:text"));
+void duckx::Document::open_mapped() {
+    this->release_package();
+    this->buffer.clear();
+    this->shared_package.reset();
+    if (!this->mapping.map(this->directory))
+        return;
+    this->open();
 }
 
-void duckx::Document::save() const {
-    // minizip only supports appending or writing to new files
-    // so we must
-    // - make a new file
-    // - write any new files
-    // - copy the old files
-    // - delete old docx
-    // - rename new file to old file
+void duckx::Document::open_copy(
+    const std::shared_ptr<const std::vector<char> > &package,
+    const pugi::xml_document &content) {
+    this->release_package();
+    this->mapping.unmap();
+    this->buffer.clear();
+    this->directory = "";
+    this->shared_package = package;
+    this->clear_content();
 
-    // Read document buffer
-    xml_string_writer writer;
-    this->document.print(writer);
+    // Copying the tree skips inflating and parsing content.xml again
+    this->document.reset(content);
+    bind_names(this->document, this->context->names);
+    this->saved_revision = this->context->revision;
 
-    // Open file and replace "xml" content
+    this->paragraph.set_parent(this->office_text());
+}
 
-    std::string original_file = this->directory;
-    std::string temp_file = this->directory + ".tmp";
+duckx::Span duckx::Document::stored_entry(const std::string &name) const {
+    Span span = {NULL, 0};
 
-    // Create the new file
-    zip_t *new_zip =
-        zip_open(temp_file.c_str(), ZIP_DEFAULT_COMPRESSION_LEVEL, 'w');
+    zip_t *zip = this->package();
+    if (!zip)
+        return span;
 
-    // Write out document.xml
-    //zip_entry_open(new_zip, "word/document.xml");
-    zip_entry_open(new_zip, "content.xml");
-    const char *buf = writer.result.c_str();
+    const void *data = NULL;
+    if (zip_entry_open(zip, name.c_str()) == 0) {
+        ssize_t size = zip_entry_data(zip, &data);
+        if (size >= 0) {
+            span.data = static_cast<const char *>(data);
+            span.size = static_cast<size_t>(size);
+        }
+    }
 
-    zip_entry_write(new_zip, buf, strlen(buf));
-    zip_entry_close(new_zip);
+    zip_entry_close(zip);
+    return span;
+}
 
-    // Open the original zip and copy all files which are not replaced by duckX
-    zip_t *orig_zip =
-        zip_open(original_file.c_str(), ZIP_DEFAULT_COMPRESSION_LEVEL, 'r');
+void duckx::Document::write_content(zip_t *new_zip,
+                                    const SaveOptions &options,
+                                    DeflatePool &pool) const {
+    zip_entry_open(new_zip, "content.xml");
+    if (pool.size()) {
+        // Serialize on this thread while the blocks are deflated on others
+        ParallelDeflateWriter writer(new_zip, pool, options.level);
+        this->document.print(writer, "", print_flags);
+        writer.finish();
+    } else {
+        // Serialize and deflate in the same pass
+        xml_zip_writer writer(new_zip);
+        this->document.print(writer, "", print_flags);
+    }
+    zip_entry_close(new_zip);
+}
 
-    // Loop & copy each relevant entry in the original zip
+void duckx::Document::write_package(zip_t *new_zip,
+                                    const SaveOptions &options) const {
+    // What happens to each entry of the new package
+    enum action { copy, content, deflate };
+    struct step {
+        action what;
+        int index;
+        size_t job;
+        std::string name;
+    };
+    std::vector<step> steps;
+    std::vector<bool> written(this->files.size(), false);
+    std::vector<bool> part_written(this->parts.size(), false);
+
+    // Changed parts are serialized up front, so that the pool compresses
+    // them with the other entries
+    std::vector<bool> part_changed(this->parts.size(), false);
+    for (size_t p = 0; p < this->parts.size(); p++)
+        part_changed[p] = this->changed(*this->parts[p]);
+
+    // Entries which have to be compressed again and the blocks of
+    // content.xml share a pool of threads, each with its own reader on the
+    // original package
+    DeflatePool pool(save_threads(options.threads),
+                     [this] { return this->open_package(); });
+    EntryDeflater deflater(pool, options.level);
+
+    // Copy all files of the original zip which are not replaced by duckX
+    zip_t *orig_zip = this->package();
+
+    // Keep the order of the original entries, so that "mimetype" stays the
+    // first entry of the package
     int orig_zip_entry_ct = zip_total_entries(orig_zip);
     for (int i = 0; i < orig_zip_entry_ct; i++) {
         zip_entry_openbyindex(orig_zip, i);
-        const char *name = zip_entry_name(orig_zip);
-
-        // Skip copying the original file
-        //if (std::string(name) != std::string("word/document.xml")) {
-        if (std::string(name) != std::string("media/"))
-        if (std::string(name) != std::string("content.xml")) {
-            // Read the old content
-            void *entry_buf;
-            size_t entry_buf_size;
-            zip_entry_read(orig_zip, &entry_buf, &entry_buf_size);
-
-            // Write into new zip
-            zip_entry_open(new_zip, name);
-            zip_entry_write(new_zip, entry_buf, entry_buf_size);
-            zip_entry_close(new_zip);
-
-            free(entry_buf);
+        step s = {copy, i, 0, zip_entry_name(orig_zip)};
+
+        size_t f = 0;
+        while (f < this->files.size() && this->files[f].first != s.name)
+            f++;
+        size_t p = 0;
+        while (p < this->parts.size() && this->parts[p]->name != s.name)
+            p++;
+
+        if (s.name == "content.xml") {
+            // content.xml untouched by the handles is copied like the
+            // other entries
+            if (this->context->revision != this->saved_revision ||
+                options.recompress)
+                s.what = content;
+        } else if (f < this->files.size()) {
+            s.what = deflate;
+            s.job = deflater.add(this->files[f].second);
+            written[f] = true;
+        } else if (p < this->parts.size() && part_changed[p]) {
+            s.what = deflate;
+            s.job = deflater.add(this->parts[p]->output);
+            part_written[p] = true;
+        } else if (options.recompress && s.name != "mimetype" &&
+                   !zip_entry_isdir(orig_zip)) {
+            s.what = deflate;
+            s.job = deflater.add(i);
         }
+        steps.push_back(s);
 
         zip_entry_close(orig_zip);
     }
 
-    // Close both zips
-    zip_close(orig_zip);
-    zip_close(new_zip);
+    // New files and parts go at the end of the package
+    for (size_t f = 0; f < this->files.size(); f++) {
+        if (written[f])
+            continue;
+        step s = {deflate, -1, deflater.add(this->files[f].second),
+                  this->files[f].first};
+        steps.push_back(s);
+    }
+    for (size_t p = 0; p < this->parts.size(); p++) {
+        if (part_written[p] || !part_changed[p] ||
+            !this->parts[p]->document.first_child())
+            continue;
+        step s = {deflate, -1, deflater.add(this->parts[p]->output),
+                  this->parts[p]->name};
+        steps.push_back(s);
+    }
 
-    // Remove original zip, rename new to correct name
-    remove(original_file.c_str());
-    rename(temp_file.c_str(), original_file.c_str());
+    deflater.start();
+
+    for (size_t i = 0; i < steps.size(); i++) {
+        const step &s = steps[i];
+        if (s.what == content) {
+            // Write out the new content.xml in place of the original one
+            // while the pool compresses the other entries
+            this->write_content(new_zip, options, pool);
+        } else if (s.what == deflate) {
+            deflater.write(s.job, new_zip, s.name.c_str());
+        } else {
+            // Unchanged entries are copied still compressed, together with
+            // their local header and crc, so they are never re-deflated
+            zip_entry_copy(new_zip, orig_zip, s.index);
+        }
+    }
 }
 
-void duckx::Document::save_copy(std::string new_name) const {
+duckx::Document::Part &
+duckx::Document::load_part(const std::string &name) const {
+    for (size_t i = 0; i < this->parts.size(); i++)
+        if (this->parts[i]->name == name)
+            return *this->parts[i];
+
+    // Parts of earlier packages are taken first, with their buffers
+    std::unique_ptr<Part> part;
+    if (!this->spare_parts.empty()) {
+        part = std::move(this->spare_parts.back());
+        this->spare_parts.pop_back();
+    } else {
+        part.reset(new Part());
+        part->document.set_memory_resource(this->arena.get());
+    }
+    part->name = name;
+    part->touched = false;
+    part->printed.clear();
+
+    zip_t *zip = this->package();
+    if (zip)
+        load_entry(zip, name.c_str(), part->document, part->text);
+
+    this->parts.push_back(std::move(part));
+    return *this->parts.back();
+}
+
+pugi::xml_document &duckx::Document::part(const std::string &name) {
+    Part &part = this->load_part(name);
+    // Reading a part does not change it, so what it looks like now is kept
+    // to tell on save
+    if (!part.touched) {
+        part.printed.clear();
+        xml_vector_writer writer(part.printed);
+        part.document.print(writer, "", print_flags);
+        part.touched = true;
+    }
+    return part.document;
+}
+
+bool duckx::Document::changed(Part &part) const {
+    part.output.clear();
+    if (!part.touched)
+        return false;
+    xml_vector_writer writer(part.output);
+    part.document.print(writer, "", print_flags);
+    return part.output != part.printed;
+}
+
+const pugi::xml_document &
+duckx::Document::part(const std::string &name) const {
+    return this->load_part(name).document;
+}
+
+pugi::xml_document &duckx::Document::styles_xml() {
+    return this->part("styles.xml");
+}
+
+const pugi::xml_document &duckx::Document::styles_xml() const {
+    return this->part("styles.xml");
+}
+
+pugi::xml_document &duckx::Document::meta() { return this->part("meta.xml"); }
+
+const pugi::xml_document &duckx::Document::meta() const {
+    return this->part("meta.xml");
+}
+
+pugi::xml_document &duckx::Document::manifest() {
+    return this->part("META-INF/manifest.xml");
+}
+
+const pugi::xml_document &duckx::Document::manifest() const {
+    return this->part("META-INF/manifest.xml");
+}
+
+void duckx::Document::add_file(const std::string &name, const void *data,
+                               size_t size) {
+    const char *bytes = static_cast<const char *>(data);
+    for (size_t i = 0; i < this->files.size(); i++) {
+        if (this->files[i].first == name) {
+            this->files[i].second.assign(bytes, bytes + size);
+            return;
+        }
+    }
+    this->files.push_back(
+        std::make_pair(name, std::vector<char>(bytes, bytes + size)));
+}
+
+// Media type of a file added to the package, from its extension
+static const char *media_type(const std::string &name) {
+    static const char *const types[][2] = {
+        {"png", "image/png"},  {"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"},
+        {"gif", "image/gif"},  {"svg", "image/svg+xml"},
+        {"bmp", "image/bmp"},  {"tif", "image/tiff"}, {"tiff", "image/tiff"},
+        {"webp", "image/webp"}};
+
+    size_t dot = name.rfind('.');
+    if (dot != std::string::npos) {
+        std::string extension = name.substr(dot + 1);
+        for (size_t i = 0; i < extension.size(); i++)
+            extension[i] = static_cast<char>(
+                tolower(static_cast<unsigned char>(extension[i])));
+        for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+            if (extension == types[i][0])
+                return types[i][1];
+    }
+    return "application/octet-stream";
+}
+
+// Prefix of the manifest namespace on the root of manifest.xml, declared
+// if the root only has it as the default namespace, since attributes
+// need a prefix
+static std::string manifest_prefix(pugi::xml_node root) {
+    static const char uri[] =
+        "urn:oasis:names:tc:opendocument:xmlns:manifest:1.0";
+    for (pugi::xml_attribute a = root.first_attribute(); a;
+         a = a.next_attribute())
+        if (strncmp(a.name(), "xmlns:", 6) == 0 && strcmp(a.value(), uri) == 0)
+            return std::string(a.name() + 6).append(":");
+
+    if (!root.attribute("xmlns:manifest"))
+        root.append_attribute("xmlns:manifest").set_value(uri);
+    return "manifest:";
+}
+
+void duckx::Document::add_media(const std::string &name, const void *data,
+                                size_t size) {
+    std::string path = std::string("media/").append(name);
+    this->add_file(path, data, size);
+
+    // Readers only take the files listed in the manifest
+    pugi::xml_node root = this->manifest().document_element();
+    if (!root)
+        return;
+    std::string prefix = manifest_prefix(root);
+    std::string file_entry = prefix + "file-entry";
+    std::string full_path = prefix + "full-path";
+    std::string type = prefix + "media-type";
+
+    pugi::xml_node entry = root.find_child_by_attribute(
+        file_entry.c_str(), full_path.c_str(), path.c_str());
+    if (!entry) {
+        entry = root.append_child(file_entry.c_str());
+        entry.append_attribute(full_path.c_str()).set_value(path.c_str());
+    }
+    pugi::xml_attribute media = entry.attribute(type.c_str());
+    if (!media)
+        media = entry.append_attribute(type.c_str());
+    media.set_value(media_type(name));
+}
+
+void duckx::Document::set_save_options(const SaveOptions &options) {
+    this->options = options;
+}
+
+const duckx::SaveOptions &duckx::Document::save_options() const {
+    return this->options;
+}
+
+bool duckx::Document::modified() const {
+    return this->modified(this->options);
+}
+
+bool duckx::Document::modified(const SaveOptions &options) const {
+    if (this->context->revision != this->saved_revision)
+        return true;
+    if (!this->files.empty() || options.recompress)
+        return true;
+    for (size_t i = 0; i < this->parts.size(); i++)
+        if (this->changed(*this->parts[i]))
+            return true;
+    return false;
+}
+
+void duckx::Document::save() const { this->save(this->options); }
+
+void duckx::Document::save(const SaveOptions &options) const {
+    // Documents opened from memory have no file to replace
+    if (this->directory.empty())
+        return;
+
+    // The file already holds everything there is to write
+    if (!this->modified(options))
+        return;
+
+    this->replace_file(options);
+}
+
+void duckx::Document::save(SaveMode mode) const {
+    // Appending needs the file to be the package the document came from,
+    // and recompressing writes every entry again anyway
+    if (mode == SaveMode::rewrite || !this->buffer.empty() ||
+        this->options.recompress) {
+        this->save(this->options);
+        return;
+    }
+
+    if (this->directory.empty() || !this->modified(this->options))
+        return;
+
+    // Entries are appended over the old central directory, so the mapping
+    // of the file cannot be kept
+    bool mapped = this->mapping.data() != NULL;
+    this->release_package();
+    this->mapping.unmap();
+
+    zip_t *zip = zip_open(this->directory.c_str(), this->options.level, 'a');
+    if (zip) {
+        // Each changed entry leaves the central directory and is written
+        // again at the end of the file
+        if (this->context->revision != this->saved_revision) {
+            zip_entry_drop(zip, "content.xml");
+            DeflatePool pool(save_threads(this->options.threads),
+                             [this] { return this->open_package(); });
+            this->write_content(zip, this->options, pool);
+        }
+        for (size_t p = 0; p < this->parts.size(); p++) {
+            Part &part = *this->parts[p];
+            if (!this->changed(part) || !part.document.first_child())
+                continue;
+            zip_entry_drop(zip, part.name.c_str());
+            zip_entry_open(zip, part.name.c_str());
+            zip_entry_write(zip, part.output.data(), part.output.size());
+            zip_entry_close(zip);
+        }
+        for (size_t f = 0; f < this->files.size(); f++) {
+            const std::vector<char> &data = this->files[f].second;
+            zip_entry_drop(zip, this->files[f].first.c_str());
+            zip_entry_open(zip, this->files[f].first.c_str());
+            zip_entry_write(zip, data.data(), data.size());
+            zip_entry_close(zip);
+        }
+
+        zip_close(zip);
+        this->mark_saved();
+    }
+
+    if (mapped)
+        this->mapping.map(this->directory);
+}
+
+void duckx::Document::compact() const {
+    if (this->directory.empty())
+        return;
+
+    // Only the entries listed in the central directory are carried over
+    this->replace_file(this->options);
+}
+
+void duckx::Document::replace_file(const SaveOptions &options) const {
     // minizip only supports appending or writing to new files
     // so we must
     // - make a new file
@@ -416,163 +1375,442 @@ void duckx::Document::save_copy(std::string new_name) const {
     // - delete old docx
     // - rename new file to old file
 
-    // Read document buffer
-    xml_string_writer writer;
-    this->document.print(writer);
-
-    // Open file and replace "xml" content
-
     std::string original_file = this->directory;
     std::string temp_file = this->directory + ".tmp";
 
     // Create the new file
-    zip_t* new_zip =
-        zip_open(temp_file.c_str(), ZIP_DEFAULT_COMPRESSION_LEVEL, 'w');
+    zip_t *new_zip =
+        zip_open(temp_file.c_str(), options.level, 'w');
+    if (!new_zip)
+        return;
 
-    // Write out document.xml
-    zip_entry_open(new_zip, "content.xml");
-    const char* buf = writer.result.c_str();
+    this->write_package(new_zip, options);
 
-    zip_entry_write(new_zip, buf, strlen(buf));
-    zip_entry_close(new_zip);
+    zip_close(new_zip);
 
-    // Open the original zip and copy all files which are not replaced by duckX
-    zip_t* orig_zip =
-        zip_open(original_file.c_str(), ZIP_DEFAULT_COMPRESSION_LEVEL, 'r');
+    // The original file cannot be removed while it is mapped on every
+    // platform, so drop the mapping and map the new file afterwards
+    bool mapped = this->mapping.data() != NULL;
+    this->release_package();
+    this->mapping.unmap();
 
-    // Loop & copy each relevant entry in the original zip
-    int orig_zip_entry_ct = zip_total_entries(orig_zip);
-    for (int i = 0; i < orig_zip_entry_ct; i++) {
-        zip_entry_openbyindex(orig_zip, i);
-        const char* name = zip_entry_name(orig_zip);
-
-        // Skip copying the original file
-        //if (std::string(name) != std::string("word/document.xml")) {
-        if (std::string(name) != std::string("media/"))
-        if (std::string(name) != std::string("content.xml")) {
-            // Read the old content
-            void* entry_buf;
-            size_t entry_buf_size;
-            zip_entry_read(orig_zip, &entry_buf, &entry_buf_size);
-
-            // Write into new zip
-            zip_entry_open(new_zip, name);
-            zip_entry_write(new_zip, entry_buf, entry_buf_size);
-            zip_entry_close(new_zip);
-
-            free(entry_buf);
-        }
+    // Remove original zip, rename new to correct name
+    remove(original_file.c_str());
+    bool replaced = rename(temp_file.c_str(), original_file.c_str()) == 0;
 
-        zip_entry_close(orig_zip);
+    if (mapped)
+        this->mapping.map(original_file);
+
+    if (replaced)
+        this->mark_saved();
+}
+
+void duckx::Document::mark_saved() const {
+    // Added files and changed parts are entries of the file now. Parts stay
+    // touched, as they may still be changed through the references handed
+    // out, and are compared with what was just written.
+    this->files.clear();
+    for (size_t i = 0; i < this->parts.size(); i++) {
+        Part &part = *this->parts[i];
+        if (this->changed(part))
+            part.printed.swap(part.output);
+    }
+    this->saved_revision = this->context->revision;
+}
+
+void duckx::Document::save_copy(std::string new_name) const {
+    this->save_copy(new_name, this->options);
+}
+
+void duckx::Document::save_copy(std::string new_name,
+                                const SaveOptions &options) const {
+    // Same as save(), but the original file is kept
+    std::string temp_file = new_name + ".tmp";
+
+    // Without changes the copy is the original package byte for byte
+    if (!this->modified(options)) {
+        Span bytes = this->package_bytes();
+        bool copied;
+        if (bytes.data) {
+            FILE *out = fopen(temp_file.c_str(), "wb");
+            copied = out != NULL &&
+                     fwrite(bytes.data, 1, bytes.size, out) == bytes.size;
+            if (out && fclose(out) != 0)
+                copied = false;
+        } else {
+            copied = copy_file(this->directory, temp_file);
+        }
+        if (copied)
+            rename(temp_file.c_str(), new_name.c_str());
+        else
+            remove(temp_file.c_str());
+        return;
     }
 
-    // Close both zips
-    zip_close(orig_zip);
+    // Create the new file
+    zip_t* new_zip =
+        zip_open(temp_file.c_str(), options.level, 'w');
+    if (!new_zip)
+        return;
+
+    this->write_package(new_zip, options);
+
     zip_close(new_zip);
 
-    // Remove original zip, rename new to correct name
-    //remove(original_file.c_str());
+    // Rename new file to the requested name
     rename(temp_file.c_str(), new_name.c_str());
 }
 
+void duckx::Document::save_to_buffer(std::vector<char> &out) const {
+    this->save_to_buffer(out, this->options);
+}
+
+void duckx::Document::save_to_buffer(std::vector<char> &out,
+                                     const SaveOptions &options) const {
+    // The zip writer patches local headers after each entry, so the package
+    // is assembled in the buffer instead of being streamed
+    out.clear();
+
+    // Without changes the original package is handed out as it is
+    if (!this->modified(options)) {
+        Span bytes = this->package_bytes();
+        if (bytes.data)
+            out.assign(bytes.data, bytes.data + bytes.size);
+        else if (!read_file(this->directory, out))
+            out.clear();
+        return;
+    }
+
+    zip_t *new_zip =
+        zip_writer_open(options.level, vector_write, &out);
+    if (!new_zip)
+        return;
+
+    this->write_package(new_zip, options);
+
+    zip_close(new_zip);
+}
+
+void duckx::Document::save_to(Writer &writer) const {
+    const SaveOptions &options = this->options;
+
+    // Without changes the original package is handed out as it is
+    if (!this->modified(options)) {
+        Span bytes = this->package_bytes();
+        if (bytes.data)
+            writer.write(bytes.data, bytes.size);
+        else
+            write_file(this->directory, writer);
+        return;
+    }
+
+    zip_stream_writer stream(writer);
+    zip_t *new_zip =
+        zip_writer_open(options.level, zip_stream_writer::write, &stream);
+    if (!new_zip)
+        return;
+    stream.zip = new_zip;
+
+    this->write_package(new_zip, options);
+
+    zip_close(new_zip);
+    stream.flush();
+}
+
 duckx::Paragraph &duckx::Document::paragraphs() {
     //this->paragraph.set_parent(document.child("w:document").child("w:body"));
-    this->paragraph.set_parent(document.child("office:document-content").child("office:body").child("office:text"));
+    this->paragraph.set_parent(this->office_text());
     return this->paragraph;
 }
 
 duckx::Table &duckx::Document::tables() {
     //this->table.set_parent(document.child("w:document").child("w:body"));
-    this->table.set_parent(document.child("office:document-content").child("office:body").child("office:text"));
+    this->table.set_parent(this->office_text());
     return this->table;
 }
 
 duckx::Style& duckx::Document::styles()
 {
-    this->style.set_parent(document.child("office:document-content").child("office:automatic-styles"));
+    this->style.set_parent(this->automatic_styles());
     return this->style;
 }
 
-duckx::Table& duckx::Document::add_table(const std::string& stylename)
+duckx::Table duckx::Document::add_table(const std::string& stylename)
 {
-    pugi::xml_node new_table = this->document.child("office:document-content").child("office:body").append_child("table:table");
-    new_table.append_attribute("table:style-name").set_value(stylename.c_str());
+    pugi::xml_node new_table = append_element(this->context.get(), this->body(), element::table);
+    new_table.append_attribute(attribute(this->context.get(), xmlns::table, "style-name").c_str()).set_value(stylename.c_str());
+    this->context->touch();
+    this->context->appended(new_table.parent(), element::table, new_table);
 
-    return *new Table(new_table.parent(), new_table);
+    Table t(new_table.parent(), new_table);
+    t.set_context(this->context.get());
+    return t;
 
 }
 
-duckx::Paragraph& duckx::Document::add_paragraph(const std::string& stylename)
+duckx::Paragraph duckx::Document::add_paragraph(const std::string& stylename)
 {
-    pugi::xml_node new_paragraph = this->document.child("office:document-content").child("office:body").append_child("text:p");
-    new_paragraph.append_attribute("text:style-name").set_value(stylename.c_str());
+    pugi::xml_node new_paragraph = append_element(this->context.get(), this->body(), element::paragraph);
+    new_paragraph.append_attribute(attribute(this->context.get(), xmlns::text, "style-name").c_str()).set_value(stylename.c_str());
+    this->context->touch();
+    this->context->appended(new_paragraph.parent(), element::paragraph, new_paragraph);
+
+    Paragraph p(new_paragraph.parent(), new_paragraph);
+    p.set_context(this->context.get());
+    return p;
+}
 
-    return *new Paragraph(new_paragraph.parent(), new_paragraph);
+pugi::xml_node duckx::Document::body() const {
+    return first_child(first_child(this->document, element::document_content),
+                       element::body);
 }
 
-duckx::Style::Style() {}
+pugi::xml_node duckx::Document::office_text() const {
+    return first_child(this->body(), element::office_text);
+}
 
-duckx::Style::Style(pugi::xml_node parent, pugi::xml_node current)
-{
-    this->set_parent(parent);
-    this->set_current(current);
+pugi::xml_node duckx::Document::automatic_styles() const {
+    return first_child(first_child(this->document, element::document_content),
+                       element::automatic_styles);
+}
+
+duckx::Paragraph duckx::Document::paragraph_at(size_t position) const {
+    pugi::xml_node text = this->office_text();
+    Paragraph p(text, child_at(this->context.get(), text, element::paragraph, position));
+    p.set_context(this->context.get());
+    return p;
+}
+
+size_t duckx::Document::paragraph_count() const {
+    return child_count(this->context.get(),
+                       this->office_text(),
+                       element::paragraph);
 }
 
+duckx::Table duckx::Document::table_at(size_t position) const {
+    pugi::xml_node text = this->office_text();
+    Table t(text, child_at(this->context.get(), text, element::table, position));
+    t.set_context(this->context.get());
+    return t;
+}
+
+size_t duckx::Document::table_count() const {
+    return child_count(this->context.get(),
+                       this->office_text(),
+                       element::table);
+}
+
+// Kind of an element, by name when it has none
+static duckx::element kind_of(pugi::xml_node node) {
+    unsigned kind = node.kind();
+    if (kind)
+        return static_cast<duckx::element>(kind);
+    return default_names.classify(node.name());
+}
+
+const std::vector<duckx::Block> &duckx::Document::blocks() const {
+    if (this->block_structure == this->context->structure)
+        return this->block_list;
+
+    this->block_list.clear();
+    this->block_structure = this->context->structure;
+
+    // Elements from the body down to the node, office:text not counting
+    // for the depth
+    std::vector<element> path;
+    unsigned text_levels = 0;
+    unsigned list_level = 0;
+    unsigned table_level = 0;
+
+    pugi::xml_node top = this->body();
+    pugi::xml_node node = top.first_child();
+    while (node) {
+        element kind = element::other;
+        if (node.type() == pugi::node_element) {
+            kind = kind_of(node);
+            if (kind == element::paragraph || kind == element::heading) {
+                Block block;
+                block.paragraph = Paragraph(node.parent(), node);
+                block.paragraph.set_context(this->context.get());
+                block.kind = kind;
+                block.container = path.empty() ? element::body : path.back();
+                block.depth = static_cast<unsigned>(path.size()) - text_levels;
+                block.list_level = list_level;
+                block.table_level = table_level;
+                this->block_list.push_back(block);
+            }
+        }
+
+        if (node.type() == pugi::node_element) {
+            pugi::xml_node child = node.first_child();
+            if (child) {
+                path.push_back(kind);
+                text_levels += kind == element::office_text;
+                list_level += kind == element::list;
+                table_level += kind == element::table_cell ||
+                               kind == element::covered_table_cell;
+                node = child;
+                continue;
+            }
+        }
+
+        while (node != top && !node.next_sibling()) {
+            node = node.parent();
+            if (node == top)
+                break;
+            element left = path.back();
+            path.pop_back();
+            text_levels -= left == element::office_text;
+            list_level -= left == element::list;
+            table_level -= left == element::table_cell ||
+                           left == element::covered_table_cell;
+        }
+        if (node == top)
+            break;
+        node = node.next_sibling();
+    }
+    return this->block_list;
+}
+
+// Append the text inside a paragraph
+static void append_text(pugi::xml_node paragraph, const char *space_count,
+                        std::string &out) {
+    pugi::xml_node node = paragraph.first_child();
+    while (node) {
+        bool descend = false;
+        if (node.type() == pugi::node_pcdata ||
+            node.type() == pugi::node_cdata) {
+            out += node.value();
+        } else if (node.type() == pugi::node_element) {
+            switch (kind_of(node)) {
+            case duckx::element::space: {
+                out.append(
+                    duckx::expanded_spaces(node.attribute(space_count).as_int(1)),
+                    ' ');
+                break;
+            }
+            case duckx::element::tab:
+                out += '\t';
+                break;
+            case duckx::element::line_break:
+                out += '\n';
+                break;
+            default:
+                descend = true;
+            }
+        }
+
+        if (descend && node.first_child()) {
+            node = node.first_child();
+            continue;
+        }
+        while (node != paragraph && !node.next_sibling())
+            node = node.parent();
+        if (node == paragraph)
+            break;
+        node = node.next_sibling();
+    }
+}
+
+void duckx::Document::extract_text(std::string &out) const {
+    std::string space_count = attribute(this->context.get(), xmlns::text, "c");
+
+    pugi::xml_node top = this->body();
+    pugi::xml_node node = top.first_child();
+    while (node) {
+        bool descend = false;
+        if (node.type() == pugi::node_element) {
+            element kind = kind_of(node);
+            if (kind == element::paragraph || kind == element::heading) {
+                append_text(node, space_count.c_str(), out);
+                out += '\n';
+            } else {
+                descend = true;
+            }
+        }
+
+        if (descend && node.first_child()) {
+            node = node.first_child();
+            continue;
+        }
+        while (node != top && !node.next_sibling())
+            node = node.parent();
+        if (node == top)
+            break;
+        node = node.next_sibling();
+    }
+}
+
+duckx::Style::Style() : context(NULL) {}
+
+duckx::Style::Style(pugi::xml_node parent, pugi::xml_node current)
+    : parent(parent), current(current), context(NULL) {}
+
 void duckx::Style::set_parent(pugi::xml_node node)
 {
     this->parent = node;
-    this->current = this->parent.child("style:style");
+    this->current = first_child(this->parent, element::style);
 }
 
 void duckx::Style::set_current(pugi::xml_node node) { this->current = node; }
 
+void duckx::Style::set_context(Context *context) { this->context = context; }
+
 bool duckx::Style::has_next() const { return this->current != 0; }
 
-duckx::Style& duckx::Style::add_style(std::string stylename, duckx::styles st, std::vector<std::pair<std::string, std::string>> attr)
+duckx::Style duckx::Style::add_style(std::string stylename, duckx::styles st, std::vector<std::pair<std::string, std::string>> attr)
 {
     // Add new run
 
-    pugi::xml_node new_style = this->parent.append_child("style:style");
-    new_style.append_attribute("style:name").set_value(stylename.c_str());
+    pugi::xml_node new_style = append_element(this->context, this->parent, element::style);
+    touch(this->context);
+    new_style.append_attribute(attribute(this->context, xmlns::style, "name").c_str()).set_value(stylename.c_str());
     pugi::xml_node new_style_props;
     switch (st)
     {
+    case duckx::styles::style:
+    {
+        // No family, so no properties element: the attributes go on the
+        // style itself
+        new_style_props = new_style;
+    }
+        break;
     case duckx::styles::table:
     {
-        new_style.append_attribute("style:family").set_value("table");
-        new_style_props = new_style.append_child("style:table-properties");
+        new_style.append_attribute(attribute(this->context, xmlns::style, "family").c_str()).set_value("table");
+        new_style_props = append_element(this->context, new_style, xmlns::style, "table-properties");
     }
         break;
     case duckx::styles::column:
     {
-        new_style.append_attribute("style:family").set_value("table-column");
-        new_style_props = new_style.append_child("style:table-column-properties");
+        new_style.append_attribute(attribute(this->context, xmlns::style, "family").c_str()).set_value("table-column");
+        new_style_props = append_element(this->context, new_style, xmlns::style, "table-column-properties");
     }
         break;
     case duckx::styles::row:
     {
-        new_style.append_attribute("style:family").set_value("table-row");
-        new_style_props = new_style.append_child("style:table-row-properties");
+        new_style.append_attribute(attribute(this->context, xmlns::style, "family").c_str()).set_value("table-row");
+        new_style_props = append_element(this->context, new_style, xmlns::style, "table-row-properties");
     }
         break;
     case duckx::styles::cell:
     {
-        new_style.append_attribute("style:family").set_value("table-cell");
-        new_style_props = new_style.append_child("style:table-cell-properties");
+        new_style.append_attribute(attribute(this->context, xmlns::style, "family").c_str()).set_value("table-cell");
+        new_style_props = append_element(this->context, new_style, xmlns::style, "table-cell-properties");
     }
         break;
     case duckx::styles::paragraph:
     {
-        new_style.append_attribute("style:parent-style-name").set_value("RegPar");
-        new_style.append_attribute("style:family").set_value("paragraph");
-        new_style_props = new_style.append_child("style:paragraph-properties");
+        new_style.append_attribute(attribute(this->context, xmlns::style, "parent-style-name").c_str()).set_value("RegPar");
+        new_style.append_attribute(attribute(this->context, xmlns::style, "family").c_str()).set_value("paragraph");
+        new_style_props = append_element(this->context, new_style, xmlns::style, "paragraph-properties");
     }
         break;
     case duckx::styles::run:
     {
-        new_style.append_attribute("style:family").set_value("text");
-        new_style_props = new_style.append_child("style:text-properties");
-        new_style.append_attribute("style:parent-style-name").set_value("RegParText");
+        new_style.append_attribute(attribute(this->context, xmlns::style, "family").c_str()).set_value("text");
+        new_style_props = append_element(this->context, new_style, xmlns::style, "text-properties");
+        new_style.append_attribute(attribute(this->context, xmlns::style, "parent-style-name").c_str()).set_value("RegParText");
     }
         break;
     }
@@ -581,10 +1819,72 @@ duckx::Style& duckx::Style::add_style(std::string stylename, duckx::styles st, s
         new_style_props.append_attribute(elem.first.c_str()).set_value(elem.second.c_str());
     }
 
-    return *new Style(this->parent, new_style);
+    Style s(this->parent, new_style);
+    s.set_context(this->context);
+    return s;
 }
 
 duckx::Style& duckx::Style::next() {
-    this->current = this->current.next_sibling("style:style");
+    this->current = next_sibling(this->current, element::style);
     return *this;
 }
+
+duckx::TemplateCache::TemplateCache() {}
+
+bool duckx::TemplateCache::parse() {
+    this->content.reset();
+
+    zip_t *zip = zip_stream_open(this->package->data(), this->package->size(),
+                                 ZIP_DEFAULT_COMPRESSION_LEVEL, 'r');
+    if (!zip) {
+        this->package.reset();
+        return false;
+    }
+
+    bool parsed =
+        load_entry(zip, "content.xml", this->content, this->content_text);
+    zip_close(zip);
+
+    // Copies of the document keep the kinds of the elements
+    if (parsed) {
+        Names names;
+        classify_tree(this->content, names);
+    }
+
+    if (!parsed)
+        this->package.reset();
+    return parsed;
+}
+
+bool duckx::TemplateCache::load(const std::string &path) {
+    std::shared_ptr<std::vector<char> > bytes(new std::vector<char>());
+    if (!read_file(path, *bytes) || bytes->empty()) {
+        this->package.reset();
+        this->content.reset();
+        return false;
+    }
+    this->package = bytes;
+    return this->parse();
+}
+
+bool duckx::TemplateCache::load(const void *data, size_t size) {
+    const char *begin = static_cast<const char *>(data);
+    this->package = std::make_shared<const std::vector<char> >(begin, begin + size);
+    return this->parse();
+}
+
+bool duckx::TemplateCache::loaded() const { return this->package != NULL; }
+
+std::unique_ptr<duckx::Document> duckx::TemplateCache::instantiate() const {
+    std::unique_ptr<Document> document(new Document());
+    this->instantiate(*document);
+    return document;
+}
+
+void duckx::TemplateCache::instantiate(Document &document) const {
+    if (!this->package) {
+        document.reset();
+        return;
+    }
+    document.open_copy(this->package, this->content);
+}
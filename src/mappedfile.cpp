@@ -0,0 +1,120 @@
+#include "mappedfile.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+duckx::MappedFile::MappedFile()
+    : address(NULL), length(0), file(INVALID_HANDLE_VALUE), mapping(NULL) {}
+#else
+duckx::MappedFile::MappedFile() : address(NULL), length(0) {}
+#endif
+
+duckx::MappedFile::~MappedFile() { this->unmap(); }
+
+duckx::MappedFile::MappedFile(MappedFile &&other) : MappedFile() {
+    *this = std::move(other);
+}
+
+duckx::MappedFile &duckx::MappedFile::operator=(MappedFile &&other) {
+    if (this != &other) {
+        this->unmap();
+        this->address = other.address;
+        this->length = other.length;
+        other.address = NULL;
+        other.length = 0;
+#ifdef _WIN32
+        this->file = other.file;
+        this->mapping = other.mapping;
+        other.file = INVALID_HANDLE_VALUE;
+        other.mapping = NULL;
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+bool duckx::MappedFile::map(const std::string &path) {
+    this->unmap();
+
+    this->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (this->file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(this->file, &size) || size.QuadPart == 0) {
+        this->unmap();
+        return false;
+    }
+
+    this->mapping =
+        CreateFileMappingA(this->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!this->mapping) {
+        this->unmap();
+        return false;
+    }
+
+    this->address = static_cast<const char *>(
+        MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!this->address) {
+        this->unmap();
+        return false;
+    }
+    this->length = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void duckx::MappedFile::unmap() {
+    if (this->address)
+        UnmapViewOfFile(this->address);
+    if (this->mapping)
+        CloseHandle(this->mapping);
+    if (this->file != INVALID_HANDLE_VALUE)
+        CloseHandle(this->file);
+    this->address = NULL;
+    this->length = 0;
+    this->mapping = NULL;
+    this->file = INVALID_HANDLE_VALUE;
+}
+#else
+bool duckx::MappedFile::map(const std::string &path) {
+    this->unmap();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void *addr = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ,
+                      MAP_SHARED, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+
+    this->address = static_cast<const char *>(addr);
+    this->length = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void duckx::MappedFile::unmap() {
+    if (this->address)
+        munmap(const_cast<char *>(this->address), this->length);
+    this->address = NULL;
+    this->length = 0;
+}
+#endif
@@ -0,0 +1,196 @@
+#include "duckx.hpp"
+
+// Paragraphs bound the placeholders, a placeholder cannot start in one
+// paragraph and end in another
+static bool is_paragraph(pugi::xml_node node, const duckx::Names &names) {
+    unsigned kind = node.kind();
+    if (kind)
+        return kind == static_cast<unsigned>(duckx::element::paragraph) ||
+               kind == static_cast<unsigned>(duckx::element::heading);
+    duckx::element element = names.classify(node.name());
+    return element == duckx::element::paragraph ||
+           element == duckx::element::heading;
+}
+
+static std::string trim(const std::string &text) {
+    size_t begin = text.find_first_not_of(" \t\n\r");
+    if (begin == std::string::npos)
+        return std::string();
+    size_t end = text.find_last_not_of(" \t\n\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+duckx::Merge::Merge(Document &document, const std::string &open,
+                    const std::string &close)
+    : document(document), open(open), close(close), count(0), revision(0) {
+    this->rebuild();
+}
+
+void duckx::Merge::rebuild() {
+    this->names.clear();
+    this->slots.clear();
+    this->count = 0;
+    this->revision = this->document.context->revision;
+
+    if (this->open.empty() || this->close.empty())
+        return;
+
+    // Text outside of paragraphs is indexed as one more paragraph
+    std::vector<pugi::xml_node> runs;
+    this->scan(this->document.body(), runs);
+    this->index(runs);
+}
+
+void duckx::Merge::scan(pugi::xml_node node,
+                        std::vector<pugi::xml_node> &runs) {
+    for (pugi::xml_node child = node.first_child(); child;
+         child = child.next_sibling()) {
+        if (child.type() == pugi::node_pcdata) {
+            runs.push_back(child);
+        } else if (child.type() != pugi::node_element) {
+            continue;
+        } else if (is_paragraph(child, this->document.context->names)) {
+            // Paragraphs inside a paragraph (e.g. in a text box) are
+            // indexed on their own
+            std::vector<pugi::xml_node> inner;
+            this->scan(child, inner);
+            this->index(inner);
+        } else {
+            this->scan(child, runs);
+        }
+    }
+}
+
+void duckx::Merge::index(const std::vector<pugi::xml_node> &runs) {
+    if (runs.empty())
+        return;
+
+    // Text of the paragraph, and where the text of each node starts in it
+    std::string text;
+    std::vector<size_t> starts;
+    for (size_t i = 0; i < runs.size(); i++) {
+        starts.push_back(text.size());
+        text += runs[i].value();
+    }
+    starts.push_back(text.size());
+
+    struct found {
+        size_t begin;
+        size_t end;
+        int field;
+    };
+    std::vector<found> placeholders;
+
+    size_t pos = 0;
+    while ((pos = text.find(this->open, pos)) != std::string::npos) {
+        size_t name_begin = pos + this->open.size();
+        size_t name_end = text.find(this->close, name_begin);
+        if (name_end == std::string::npos)
+            break;
+
+        // "{{a {{b}}" holds the placeholder "{{b}}"
+        size_t nested = text.find(this->open, name_begin);
+        if (nested < name_end) {
+            pos = nested;
+            continue;
+        }
+
+        std::string name = trim(text.substr(name_begin, name_end - name_begin));
+        size_t end = name_end + this->close.size();
+        if (!name.empty()) {
+            size_t field = 0;
+            while (field < this->names.size() && this->names[field] != name)
+                field++;
+            if (field == this->names.size())
+                this->names.push_back(name);
+
+            found f = {pos, end, static_cast<int>(field)};
+            placeholders.push_back(f);
+        }
+        pos = end;
+    }
+
+    if (placeholders.empty())
+        return;
+    this->count += placeholders.size();
+
+    // Split the text of every node touched by a placeholder into pieces.
+    // The value goes to the node where the placeholder starts, the nodes
+    // holding the rest of it only keep their other text.
+    size_t first = 0;
+    for (size_t i = 0; i < runs.size(); i++) {
+        size_t begin = starts[i];
+        size_t end = starts[i + 1];
+        while (first < placeholders.size() && placeholders[first].end <= begin)
+            first++;
+        if (begin == end || first == placeholders.size() ||
+            placeholders[first].begin >= end)
+            continue;
+
+        Slot slot;
+        slot.node = runs[i];
+        size_t at = begin;
+        for (size_t p = first;
+             p < placeholders.size() && placeholders[p].begin < end; p++) {
+            const found &f = placeholders[p];
+            if (f.begin > at) {
+                Piece literal = {text.substr(at, f.begin - at), -1};
+                slot.pieces.push_back(literal);
+            }
+            if (f.begin >= begin) {
+                Piece value = {text.substr(f.begin, f.end - f.begin), f.field};
+                slot.pieces.push_back(value);
+            }
+            at = f.end < end ? f.end : end;
+        }
+        if (at < end) {
+            Piece literal = {text.substr(at, end - at), -1};
+            slot.pieces.push_back(literal);
+        }
+        this->slots.push_back(slot);
+    }
+}
+
+const std::vector<std::string> &duckx::Merge::fields() const {
+    return this->names;
+}
+
+size_t duckx::Merge::size() const { return this->count; }
+
+void duckx::Merge::fill(const Record &record) {
+    // The nodes may be gone if the document was changed in between
+    if (this->revision != this->document.context->revision)
+        this->rebuild();
+
+    std::vector<const std::string *> values(this->names.size(), NULL);
+    for (size_t i = 0; i < this->names.size(); i++) {
+        Record::const_iterator it = record.find(this->names[i]);
+        if (it != record.end())
+            values[i] = &it->second;
+    }
+
+    for (size_t i = 0; i < this->slots.size(); i++) {
+        Slot &slot = this->slots[i];
+        this->value.clear();
+        for (size_t p = 0; p < slot.pieces.size(); p++) {
+            const Piece &piece = slot.pieces[p];
+            if (piece.field >= 0 && values[piece.field])
+                this->value += *values[piece.field];
+            else
+                this->value += piece.text;
+        }
+        slot.node.set_value(this->value.c_str());
+    }
+
+    this->document.context->touch();
+    this->revision = this->document.context->revision;
+}
+
+void duckx::Merge::merge(const std::vector<Record> &records,
+                         std::vector<std::vector<char> > &outputs) {
+    outputs.resize(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        this->fill(records[i]);
+        this->document.save_to_buffer(outputs[i]);
+    }
+}
@@ -0,0 +1,176 @@
+#include "names.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+struct space_info {
+    const char *prefix;
+    const char *uri;
+};
+
+// Usual prefix and uri by namespace
+static const space_info spaces[] = {
+    {"", ""},
+    {"office", "urn:oasis:names:tc:opendocument:xmlns:office:1.0"},
+    {"text", "urn:oasis:names:tc:opendocument:xmlns:text:1.0"},
+    {"table", "urn:oasis:names:tc:opendocument:xmlns:table:1.0"},
+    {"style", "urn:oasis:names:tc:opendocument:xmlns:style:1.0"},
+    {"draw", "urn:oasis:names:tc:opendocument:xmlns:drawing:1.0"},
+    {"svg", "urn:oasis:names:tc:opendocument:xmlns:svg-compatible:1.0"},
+    {"xlink", "http://www.w3.org/1999/xlink"}};
+
+struct element_info {
+    duckx::element kind;
+    duckx::xmlns space;
+    const char *local;
+};
+
+// Namespace and local name by element kind
+static const element_info elements[] = {
+    {duckx::element::document_content, duckx::xmlns::office,
+     "document-content"},
+    {duckx::element::body, duckx::xmlns::office, "body"},
+    {duckx::element::office_text, duckx::xmlns::office, "text"},
+    {duckx::element::automatic_styles, duckx::xmlns::office,
+     "automatic-styles"},
+    {duckx::element::paragraph, duckx::xmlns::text, "p"},
+    {duckx::element::heading, duckx::xmlns::text, "h"},
+    {duckx::element::span, duckx::xmlns::text, "span"},
+    {duckx::element::space, duckx::xmlns::text, "s"},
+    {duckx::element::tab, duckx::xmlns::text, "tab"},
+    {duckx::element::line_break, duckx::xmlns::text, "line-break"},
+    {duckx::element::table, duckx::xmlns::table, "table"},
+    {duckx::element::table_row, duckx::xmlns::table, "table-row"},
+    {duckx::element::table_cell, duckx::xmlns::table, "table-cell"},
+    {duckx::element::covered_table_cell, duckx::xmlns::table,
+     "covered-table-cell"},
+    {duckx::element::list, duckx::xmlns::text, "list"},
+    {duckx::element::list_item, duckx::xmlns::text, "list-item"},
+    {duckx::element::list_header, duckx::xmlns::text, "list-header"},
+    {duckx::element::section, duckx::xmlns::text, "section"},
+    {duckx::element::style, duckx::xmlns::style, "style"}};
+
+static const size_t element_count = sizeof(elements) / sizeof(elements[0]);
+
+static bool contains(const std::vector<std::string> &list,
+                     const std::string &value) {
+    return std::find(list.begin(), list.end(), value) != list.end();
+}
+
+duckx::Names::Names() { this->reset(); }
+
+void duckx::Names::reset() {
+    for (int i = 0; i < static_cast<int>(xmlns::count); i++) {
+        this->prefixes[i] = spaces[i].prefix;
+        this->attribute_prefixes[i] = spaces[i].prefix;
+        this->defaults[i] = false;
+        this->declared[i] = false;
+    }
+    this->bound.clear();
+    this->update();
+}
+
+void duckx::Names::update() {
+    for (size_t i = 0; i < element_count; i++)
+        this->names[static_cast<int>(elements[i].kind)] =
+            this->qualify(elements[i].space, elements[i].local);
+}
+
+void duckx::Names::bind(const char *attribute, const char *uri) {
+    if (strncmp(attribute, "xmlns", 5) != 0)
+        return;
+
+    const char *prefix;
+    if (attribute[5] == ':')
+        prefix = attribute + 6;
+    else if (attribute[5] == 0)
+        prefix = "";
+    else
+        return;
+    if (*prefix)
+        this->bound.push_back(prefix);
+
+    for (int i = 1; i < static_cast<int>(xmlns::count); i++) {
+        if (strcmp(uri, spaces[i].uri) != 0)
+            continue;
+
+        // Elements are written without a prefix when the namespace is the
+        // default one, attributes always with one
+        if (!*prefix) {
+            this->prefixes[i] = prefix;
+            this->defaults[i] = true;
+        } else {
+            this->attribute_prefixes[i] = prefix;
+            this->declared[i] = true;
+            if (!this->defaults[i])
+                this->prefixes[i] = prefix;
+        }
+        this->update();
+        return;
+    }
+}
+
+std::vector<std::pair<std::string, std::string> > duckx::Names::declare() {
+    std::vector<std::pair<std::string, std::string> > attributes;
+    for (int i = 1; i < static_cast<int>(xmlns::count); i++) {
+        if (this->declared[i])
+            continue;
+
+        // The usual prefix, unless the document binds it to something else:
+        // elements and attributes then keep the usual prefix as they always
+        // did, only a default namespace gets another prefix
+        std::string prefix = spaces[i].prefix;
+        bool taken = contains(this->bound, prefix);
+        if (taken && !this->defaults[i])
+            continue;
+        for (int n = 1; taken; n++) {
+            prefix = spaces[i].prefix + std::to_string(n);
+            taken = contains(this->bound, prefix);
+        }
+
+        std::string attribute = "xmlns:" + prefix;
+        attributes.push_back(std::make_pair(attribute, spaces[i].uri));
+        this->bind(attribute.c_str(), spaces[i].uri);
+    }
+    return attributes;
+}
+
+duckx::element duckx::Names::classify(const char *name) const {
+    return this->classify(name, strlen(name));
+}
+
+duckx::element duckx::Names::classify(const char *name, size_t size) const {
+    const char *colon = static_cast<const char *>(memchr(name, ':', size));
+    size_t prefix_size = colon ? static_cast<size_t>(colon - name) : 0;
+    const char *local = colon ? colon + 1 : name;
+    size_t local_size = size - static_cast<size_t>(local - name);
+
+    for (int i = 1; i < static_cast<int>(xmlns::count); i++) {
+        const std::string &prefix = this->prefixes[i];
+        if (prefix.size() != prefix_size ||
+            memcmp(prefix.data(), name, prefix_size) != 0)
+            continue;
+
+        for (size_t e = 0; e < element_count; e++)
+            if (static_cast<int>(elements[e].space) == i &&
+                strlen(elements[e].local) == local_size &&
+                memcmp(elements[e].local, local, local_size) == 0)
+                return elements[e].kind;
+    }
+    return element::other;
+}
+
+std::string duckx::Names::qualify(xmlns space, const char *local) const {
+    const std::string &prefix = this->prefixes[static_cast<int>(space)];
+    if (prefix.empty())
+        return local;
+    return prefix + ":" + local;
+}
+
+std::string duckx::Names::attribute(xmlns space, const char *local) const {
+    const std::string &prefix =
+        this->attribute_prefixes[static_cast<int>(space)];
+    if (prefix.empty())
+        return local;
+    return prefix + ":" + local;
+}
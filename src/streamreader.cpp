@@ -0,0 +1,330 @@
+#include "streamreader.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "constants.hpp"
+#include "xmltext.hpp"
+
+// Size of the first buffer, it only grows for longer tags or texts
+static const size_t chunk_size = 64 * 1024;
+
+// Events of the elements the reader reports
+static bool element_events(duckx::element kind,
+                           duckx::StreamReader::Event &begin,
+                           duckx::StreamReader::Event &end) {
+    typedef duckx::StreamReader::Event Event;
+    switch (kind) {
+    case duckx::element::paragraph:
+    case duckx::element::heading:
+        begin = Event::paragraph_begin;
+        end = Event::paragraph_end;
+        return true;
+    case duckx::element::table:
+        begin = Event::table_begin;
+        end = Event::table_end;
+        return true;
+    case duckx::element::table_row:
+        begin = Event::row_begin;
+        end = Event::row_end;
+        return true;
+    case duckx::element::table_cell:
+    case duckx::element::covered_table_cell:
+        begin = Event::cell_begin;
+        end = Event::cell_end;
+        return true;
+    default:
+        return false;
+    }
+}
+
+duckx::StreamReader::StreamReader()
+    : zip(NULL), pos(0), avail(0), eof(true), failed(false),
+      pending(false), pending_event(Event::end), paragraphs(0),
+      bound(false) {}
+
+duckx::StreamReader::~StreamReader() { this->close(); }
+
+bool duckx::StreamReader::open(const std::string &path) {
+    this->close();
+    this->zip = zip_open(path.c_str(), ZIP_DEFAULT_COMPRESSION_LEVEL, 'r');
+    return this->start();
+}
+
+bool duckx::StreamReader::open(const void *data, size_t size) {
+    this->close();
+    this->zip = zip_stream_open(static_cast<const char *>(data), size,
+                                ZIP_DEFAULT_COMPRESSION_LEVEL, 'r');
+    return this->start();
+}
+
+bool duckx::StreamReader::start() {
+    if (!this->zip)
+        return false;
+    if (zip_entry_open(this->zip, "content.xml") != 0) {
+        this->close();
+        return false;
+    }
+
+    if (this->data.size() < chunk_size)
+        this->data.resize(chunk_size);
+    this->pos = 0;
+    this->avail = 0;
+    this->eof = false;
+    this->failed = false;
+    this->pending = false;
+    this->paragraphs = 0;
+    this->names.reset();
+    this->bound = false;
+    return true;
+}
+
+void duckx::StreamReader::close() {
+    if (this->zip) {
+        zip_entry_close(this->zip);
+        zip_close(this->zip);
+        this->zip = NULL;
+    }
+    this->eof = true;
+}
+
+bool duckx::StreamReader::fill() {
+    if (this->eof)
+        return false;
+
+    // Keep the unparsed bytes at the front, and grow the buffer only if
+    // they take all of it
+    if (this->pos) {
+        memmove(this->data.data(), this->data.data() + this->pos,
+                this->avail - this->pos);
+        this->avail -= this->pos;
+        this->pos = 0;
+    }
+    if (this->avail == this->data.size())
+        this->data.resize(this->data.size() * 2);
+
+    ssize_t read = zip_entry_readchunk(this->zip,
+                                       this->data.data() + this->avail,
+                                       this->data.size() - this->avail);
+    if (read <= 0) {
+        this->eof = true;
+        this->failed = read < 0;
+        return false;
+    }
+    this->avail += static_cast<size_t>(read);
+    return true;
+}
+
+bool duckx::StreamReader::starts_with(const char *prefix) {
+    size_t size = strlen(prefix);
+    while (this->avail - this->pos < size)
+        if (!this->fill())
+            return false;
+    return memcmp(this->data.data() + this->pos, prefix, size) == 0;
+}
+
+// Offset of pattern from the current position, searching from `from`
+size_t duckx::StreamReader::search(const char *pattern, size_t from) {
+    size_t size = strlen(pattern);
+    for (;;) {
+        const char *begin = this->data.data() + this->pos;
+        const char *end = this->data.data() + this->avail;
+        if (begin + from < end) {
+            const char *found =
+                std::search(begin + from, end, pattern, pattern + size);
+            if (found != end)
+                return static_cast<size_t>(found - begin);
+        }
+
+        // The pattern may start in the bytes already searched
+        size_t searched = static_cast<size_t>(end - begin);
+        if (searched + 1 > size && searched + 1 - size > from)
+            from = searched + 1 - size;
+        if (!this->fill())
+            return std::string::npos;
+    }
+}
+
+// Offset of the '>' closing the tag at the current position
+size_t duckx::StreamReader::tag_end() {
+    char quote = 0;
+    size_t i = 1;
+    for (;;) {
+        while (this->pos + i < this->avail) {
+            char c = this->data[this->pos + i];
+            if (quote) {
+                if (c == quote)
+                    quote = 0;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == '>') {
+                return i;
+            }
+            i++;
+        }
+        if (!this->fill())
+            return std::string::npos;
+    }
+}
+
+void duckx::StreamReader::parse_tag(const char *text, size_t size,
+                                    bool with_attributes) {
+    const char *end = text + size;
+    const char *name = text;
+    while (text < end && !is_space(*text) && *text != '/')
+        text++;
+    this->tag.assign(name, text);
+
+    this->attributes.clear();
+    if (!with_attributes)
+        return;
+
+    RawAttribute raw;
+    while ((text = next_attribute(text, end, raw)) != NULL) {
+        std::pair<std::string, std::string> attribute;
+        attribute.first.assign(raw.name, raw.name_end);
+        decode(raw.value, raw.value_end, attribute.second);
+        this->attributes.push_back(attribute);
+    }
+}
+
+duckx::StreamReader::Event duckx::StreamReader::next() {
+    if (this->pending) {
+        this->pending = false;
+        if (this->pending_event == Event::paragraph_end && this->paragraphs)
+            this->paragraphs--;
+        return this->pending_event;
+    }
+
+    for (;;) {
+        if (this->pos == this->avail && !this->fill())
+            return this->failed ? Event::error : Event::end;
+
+        const char *at = this->data.data() + this->pos;
+        if (*at != '<') {
+            size_t size = this->search("<", 0);
+            if (size == std::string::npos)
+                size = this->avail - this->pos;
+            if (this->paragraphs) {
+                this->value.clear();
+                const char *text = this->data.data() + this->pos;
+                decode(text, text + size, this->value);
+                this->pos += size;
+                return Event::text;
+            }
+            this->pos += size;
+            continue;
+        }
+
+        // Markup other than elements
+        if (this->starts_with("<!--")) {
+            size_t size = this->search("-->", 4);
+            if (size == std::string::npos)
+                return Event::error;
+            this->pos += size + 3;
+            continue;
+        }
+        if (this->starts_with("<![CDATA[")) {
+            size_t size = this->search("]]>", 9);
+            if (size == std::string::npos)
+                return Event::error;
+            const char *text = this->data.data() + this->pos + 9;
+            this->value.assign(text, text + size - 9);
+            this->pos += size + 3;
+            if (this->paragraphs && !this->value.empty())
+                return Event::text;
+            continue;
+        }
+        if (this->starts_with("<?") || this->starts_with("<!")) {
+            size_t size = this->search(">", 2);
+            if (size == std::string::npos)
+                return Event::error;
+            this->pos += size + 1;
+            continue;
+        }
+
+        size_t size = this->tag_end();
+        if (size == std::string::npos)
+            return Event::error;
+
+        const char *text = this->data.data() + this->pos + 1;
+        size_t length = size - 1;
+        bool closing = length && text[0] == '/';
+        bool empty = !closing && length && text[length - 1] == '/';
+
+        if (closing) {
+            this->parse_tag(text + 1, length - 1, false);
+            this->pos += size + 1;
+
+            Event begin, end;
+            if (!element_events(this->names.classify(this->tag.data(),
+                                                     this->tag.size()),
+                                begin, end))
+                continue;
+            if (end == Event::paragraph_end && this->paragraphs)
+                this->paragraphs--;
+            return end;
+        }
+
+        // Look at the name first, the attributes are only parsed for
+        // elements which are reported
+        const char *name_end = text;
+        while (name_end < text + length && !is_space(*name_end) &&
+               *name_end != '/')
+            name_end++;
+
+        // The root element declares the prefixes of the namespaces
+        if (!this->bound) {
+            bind_attributes(name_end, text + length, this->names);
+            this->space_count = this->names.attribute(xmlns::text, "c");
+            this->bound = true;
+        }
+        element kind =
+            this->names.classify(text, static_cast<size_t>(name_end - text));
+
+        Event begin, end;
+        if (element_events(kind, begin, end)) {
+            this->parse_tag(text, length, true);
+            this->pos += size + 1;
+            if (begin == Event::paragraph_begin)
+                this->paragraphs++;
+            if (empty) {
+                this->pending = true;
+                this->pending_event = end;
+            }
+            return begin;
+        }
+
+        if (this->paragraphs &&
+            (kind == element::space || kind == element::tab ||
+             kind == element::line_break)) {
+            this->parse_tag(text, length, kind == element::space);
+            this->pos += size + 1;
+
+            if (kind == element::tab) {
+                this->value = "\t";
+            } else if (kind == element::line_break) {
+                this->value = "\n";
+            } else {
+                std::string count = this->attribute(this->space_count);
+                long spaces = count.empty() ? 1 : strtol(count.c_str(), NULL, 10);
+                this->value.assign(expanded_spaces(spaces), ' ');
+            }
+            return Event::text;
+        }
+
+        this->pos += size + 1;
+    }
+}
+
+const std::string &duckx::StreamReader::text() const { return this->value; }
+
+const std::string &duckx::StreamReader::name() const { return this->tag; }
+
+std::string duckx::StreamReader::attribute(const std::string &name) const {
+    for (size_t i = 0; i < this->attributes.size(); i++)
+        if (this->attributes[i].first == name)
+            return this->attributes[i].second;
+    return std::string();
+}
@@ -0,0 +1,292 @@
+#include "streamwriter.hpp"
+
+#include <cstring>
+
+#include "pugixml/pugixml.hpp"
+
+// Output is deflated in blocks of this size
+static const size_t flush_size = 64 * 1024;
+
+// Marks where the elements go in the printed template
+static const char marker[] = "<?duckx-stream?>";
+
+// Child of node with the given kind
+static pugi::xml_node find_child(pugi::xml_node node,
+                                 const duckx::Names &names,
+                                 duckx::element kind) {
+    for (pugi::xml_node child = node.first_child(); child;
+         child = child.next_sibling())
+        if (child.type() == pugi::node_element &&
+            names.classify(child.name()) == kind)
+            return child;
+    return pugi::xml_node();
+}
+
+struct xml_string_writer : pugi::xml_writer {
+    std::string &result;
+
+    explicit xml_string_writer(std::string &result) : result(result) {}
+
+    virtual void write(const void *data, size_t size) {
+        result.append(static_cast<const char *>(data), size);
+    }
+};
+
+duckx::StreamWriter::StreamWriter() : zip(NULL), source(NULL), next_entry(0) {}
+
+duckx::StreamWriter::~StreamWriter() { this->close(); }
+
+bool duckx::StreamWriter::is_open() const { return this->zip != NULL; }
+
+bool duckx::StreamWriter::open(const std::string &template_path,
+                               const std::string &output) {
+    this->close();
+
+    this->source =
+        zip_open(template_path.c_str(), ZIP_DEFAULT_COMPRESSION_LEVEL, 'r');
+    if (!this->source)
+        return false;
+
+    // The template is printed with a marker after the text it already has,
+    // and split around the marker
+    std::string content;
+    if (zip_entry_open(this->source, "content.xml") == 0) {
+        std::vector<char> text((size_t)zip_entry_size(this->source) + 1);
+        pugi::xml_document document;
+        if (zip_entry_noallocread(this->source, text.data(), text.size()) >=
+                0 &&
+            document.load_buffer_inplace(
+                text.data(), text.size() - 1,
+                pugi::parse_default | pugi::parse_ws_pcdata)) {
+            pugi::xml_node root = document.document_element();
+            this->names.reset();
+            for (pugi::xml_attribute attribute = root.first_attribute();
+                 attribute; attribute = attribute.next_attribute())
+                this->names.bind(attribute.name(), attribute.value());
+            std::vector<std::pair<std::string, std::string> > declarations =
+                this->names.declare();
+            for (size_t i = 0; i < declarations.size(); i++)
+                root.append_attribute(declarations[i].first.c_str())
+                    .set_value(declarations[i].second.c_str());
+
+            pugi::xml_node body =
+                find_child(root, this->names, element::body);
+            pugi::xml_node parent =
+                find_child(body, this->names, element::office_text);
+            if (!parent)
+                parent = body;
+            if (parent)
+                parent.append_child(pugi::node_pi).set_name("duckx-stream");
+
+            xml_string_writer writer(content);
+            document.save(writer, "", pugi::format_raw);
+        }
+    }
+    zip_entry_close(this->source);
+
+    size_t at = content.find(marker);
+    if (at == std::string::npos) {
+        this->close();
+        return false;
+    }
+
+    this->zip = zip_open(output.c_str(), ZIP_DEFAULT_COMPRESSION_LEVEL, 'w');
+    if (!this->zip) {
+        this->close();
+        return false;
+    }
+
+    // Entries before content.xml are copied now, so that "mimetype" stays
+    // the first entry; the others when the package is closed
+    int total = zip_total_entries(this->source);
+    for (this->next_entry = 0; this->next_entry < total; this->next_entry++) {
+        zip_entry_openbyindex(this->source, this->next_entry);
+        bool content_entry =
+            strcmp(zip_entry_name(this->source), "content.xml") == 0;
+        zip_entry_close(this->source);
+        if (content_entry) {
+            this->next_entry++;
+            break;
+        }
+        zip_entry_copy(this->zip, this->source, this->next_entry);
+    }
+
+    zip_entry_open(this->zip, "content.xml");
+    this->out.assign(content, 0, at);
+    this->tail.assign(content, at + sizeof(marker) - 1, std::string::npos);
+    this->text_style = this->names.attribute(xmlns::text, "style-name");
+    this->table_style = this->names.attribute(xmlns::table, "style-name");
+    this->open_elements.clear();
+    return true;
+}
+
+bool duckx::StreamWriter::close() {
+    bool ok = false;
+
+    if (this->zip) {
+        while (!this->open_elements.empty())
+            this->end();
+        this->out += this->tail;
+        this->flush();
+        ok = zip_entry_close(this->zip) == 0;
+
+        int total = zip_total_entries(this->source);
+        for (; this->next_entry < total; this->next_entry++)
+            if (zip_entry_copy(this->zip, this->source, this->next_entry) != 0)
+                ok = false;
+
+        zip_close(this->zip);
+        this->zip = NULL;
+    }
+    if (this->source) {
+        zip_close(this->source);
+        this->source = NULL;
+    }
+
+    this->tail.clear();
+    this->out.clear();
+    this->open_elements.clear();
+    return ok;
+}
+
+void duckx::StreamWriter::flush() {
+    if (!this->out.empty())
+        zip_entry_write(this->zip, this->out.data(), this->out.size());
+    this->out.clear();
+}
+
+void duckx::StreamWriter::escape(const std::string &text, bool attribute) {
+    for (size_t i = 0; i < text.size(); i++) {
+        switch (text[i]) {
+        case '&':
+            this->out += "&amp;";
+            break;
+        case '<':
+            this->out += "&lt;";
+            break;
+        case '>':
+            this->out += "&gt;";
+            break;
+        case '"':
+            if (attribute)
+                this->out += "&quot;";
+            else
+                this->out += '"';
+            break;
+        default:
+            this->out += text[i];
+        }
+    }
+}
+
+void duckx::StreamWriter::begin(element kind, const std::string &attribute,
+                                const std::string &value) {
+    this->out += '<';
+    this->out += this->names.name(kind);
+    // An empty style name is not a style, the element keeps the default
+    if (!value.empty()) {
+        this->out += ' ';
+        this->out += attribute;
+        this->out += "=\"";
+        this->escape(value, true);
+        this->out += '"';
+    }
+    this->out += '>';
+    this->open_elements.push_back(kind);
+}
+
+void duckx::StreamWriter::end() {
+    this->out += "</";
+    this->out += this->names.name(this->open_elements.back());
+    this->out += '>';
+    this->open_elements.pop_back();
+
+    if (this->out.size() >= flush_size)
+        this->flush();
+}
+
+// End the open elements up to the innermost `kind` or `other`
+void duckx::StreamWriter::end_until(element kind, element other) {
+    while (!this->open_elements.empty() &&
+           this->open_elements.back() != kind &&
+           this->open_elements.back() != other)
+        this->end();
+}
+
+void duckx::StreamWriter::add_paragraph(const std::string &stylename) {
+    if (!this->zip)
+        return;
+    this->end_until(element::table_cell, element::table_cell);
+    this->begin(element::paragraph, this->text_style, stylename);
+}
+
+void duckx::StreamWriter::add_run(const std::string &text,
+                                  const std::string &stylename) {
+    if (!this->zip)
+        return;
+    if (this->open_elements.empty() ||
+        this->open_elements.back() != element::paragraph)
+        this->add_paragraph();
+
+    this->begin(element::span, this->text_style, stylename);
+    this->escape(text, false);
+    this->end();
+}
+
+void duckx::StreamWriter::add_table(const std::string &stylename) {
+    if (!this->zip)
+        return;
+    this->end_until(element::table_cell, element::table_cell);
+    this->begin(element::table, this->table_style, stylename);
+}
+
+void duckx::StreamWriter::add_column(const std::vector<std::string> &stylenames) {
+    if (!this->zip)
+        return;
+    this->end_until(element::table, element::table);
+    if (this->open_elements.empty())
+        return;
+
+    std::string columns = this->names.qualify(xmlns::table, "table-columns");
+    std::string column = this->names.qualify(xmlns::table, "table-column");
+    this->out += "<" + columns + ">";
+    for (size_t i = 0; i < stylenames.size(); i++) {
+        this->out += "<" + column;
+        if (!stylenames[i].empty()) {
+            this->out += " " + this->table_style + "=\"";
+            this->escape(stylenames[i], true);
+            this->out += '"';
+        }
+        this->out += "/>";
+    }
+    this->out += "</" + columns + ">";
+}
+
+void duckx::StreamWriter::add_row(const std::string &stylename) {
+    if (!this->zip)
+        return;
+    this->end_until(element::table, element::table);
+    if (this->open_elements.empty())
+        return;
+    this->begin(element::table_row, this->table_style, stylename);
+}
+
+void duckx::StreamWriter::add_cell(const std::string &cellstyle,
+                                   const std::string &parstyle) {
+    if (!this->zip)
+        return;
+    this->end_until(element::table_row, element::table);
+    if (this->open_elements.empty() ||
+        this->open_elements.back() != element::table_row)
+        return;
+    this->begin(element::table_cell, this->table_style, cellstyle);
+    this->begin(element::paragraph, this->text_style, parstyle);
+}
+
+void duckx::StreamWriter::end_table() {
+    if (!this->zip)
+        return;
+    this->end_until(element::table, element::table);
+    if (!this->open_elements.empty())
+        this->end();
+}
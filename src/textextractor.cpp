@@ -0,0 +1,310 @@
+#include "textextractor.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "constants.hpp"
+#include "xmltext.hpp"
+
+// Bytes are looked for 16 at a time when the target has SSE2
+#if defined(__SSE2__) || defined(_M_X64) ||                                \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DUCKX_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifdef DUCKX_SSE2
+// Index of the lowest bit set in a non zero mask
+static unsigned lowest_bit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+// First of the bytes a, b or c in [begin, end), or end. Like memchr, but
+// for several bytes at once: a block is compared with each of them and the
+// matches are combined into one mask.
+static const char *find_any(const char *begin, const char *end, char a,
+                            char b, char c) {
+#ifdef DUCKX_SSE2
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c);
+    while (end - begin >= 16) {
+        __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        __m128i match = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, va),
+                                                  _mm_cmpeq_epi8(block, vb)),
+                                     _mm_cmpeq_epi8(block, vc));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(match));
+        if (mask)
+            return begin + lowest_bit(mask);
+        begin += 16;
+    }
+#endif
+    for (; begin < end; begin++)
+        if (*begin == a || *begin == b || *begin == c)
+            return begin;
+    return end;
+}
+
+// First of the bytes a or b in [begin, end), or end; find_any() for two
+// bytes, which saves a comparison per block on the text of paragraphs
+static const char *find_either(const char *begin, const char *end, char a,
+                               char b) {
+#ifdef DUCKX_SSE2
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    while (end - begin >= 16) {
+        __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        __m128i match = _mm_or_si128(_mm_cmpeq_epi8(block, va),
+                                     _mm_cmpeq_epi8(block, vb));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(match));
+        if (mask)
+            return begin + lowest_bit(mask);
+        begin += 16;
+    }
+#endif
+    for (; begin < end; begin++)
+        if (*begin == a || *begin == b)
+            return begin;
+    return end;
+}
+
+// Append text with its line ends normalized as the parser of the DOM does:
+// "\r\n" and a lone '\r' become '\n'
+static void append_lines(const char *text, const char *end,
+                         std::string &out) {
+    while (text < end) {
+        const char *cr = duckx::find(text, end, '\r');
+        out.append(text, cr);
+        if (cr == end)
+            return;
+        out += '\n';
+        text = cr + 1;
+        if (text < end && *text == '\n')
+            text++;
+    }
+}
+
+static bool starts_with(const char *at, const char *end, const char *prefix) {
+    size_t size = strlen(prefix);
+    return static_cast<size_t>(end - at) >= size &&
+           memcmp(at, prefix, size) == 0;
+}
+
+// First occurrence of pattern in [begin, end), or NULL
+static const char *search(const char *begin, const char *end,
+                          const char *pattern) {
+    for (const char *at = duckx::find(begin, end, pattern[0]); at != end;
+         at = duckx::find(at + 1, end, pattern[0]))
+        if (starts_with(at, end, pattern))
+            return at;
+    return NULL;
+}
+
+// The '>' closing the tag starting at `at`, or NULL. Attribute values are
+// skipped whole, since they may hold a '>'.
+static const char *tag_end(const char *at, const char *end) {
+    for (;;) {
+        at = find_any(at, end, '>', '"', '\'');
+        if (at == end)
+            return NULL;
+        if (*at == '>')
+            return at;
+        at = duckx::find(at + 1, end, *at);
+        if (at == end)
+            return NULL;
+        at++;
+    }
+}
+
+duckx::TextExtractor::TextExtractor() {}
+
+// Take the attributes of the root element into account
+void duckx::TextExtractor::bind(const char *text, const char *end) {
+    bind_attributes(text, end, this->names);
+    this->space_count = this->names.attribute(xmlns::text, "c");
+    this->text_prefix = this->names.qualify(xmlns::text, "");
+    this->body_name = this->names.qualify(xmlns::office, "body");
+}
+
+// Kind of the elements of the text namespace the text depends on, the
+// others are not told apart
+duckx::element duckx::TextExtractor::classify(const char *name,
+                                              size_t size) const {
+    const std::string &prefix = this->text_prefix;
+    if (size <= prefix.size() ||
+        memcmp(name, prefix.data(), prefix.size()) != 0)
+        return element::other;
+    const char *local = name + prefix.size();
+    switch (size - prefix.size()) {
+    case 1:
+        if (*local == 'p')
+            return element::paragraph;
+        if (*local == 'h')
+            return element::heading;
+        if (*local == 's')
+            return element::space;
+        break;
+    case 3:
+        if (memcmp(local, "tab", 3) == 0)
+            return element::tab;
+        break;
+    case 10:
+        if (memcmp(local, "line-break", 10) == 0)
+            return element::line_break;
+        break;
+    }
+    return element::other;
+}
+
+bool duckx::TextExtractor::extract(const char *xml, size_t size,
+                                   std::string &out) {
+    const char *at = xml;
+    const char *end = xml + size;
+    // Depth of nested paragraphs, only the outermost ends with a line feed
+    int paragraphs = 0;
+    bool bound = false;
+    // Paragraphs are only looked for in office:body, as by the DOM
+    bool in_body = false;
+
+    while (at < end) {
+        // Text is copied up to the next markup or reference, found in the
+        // same pass; text outside paragraphs is only skipped
+        if (paragraphs) {
+            const char *stop = find_either(at, end, '<', '&');
+            append_lines(at, stop, out);
+            at = stop;
+            if (at < end && *at == '&') {
+                at = decode_reference(at, end, out);
+                continue;
+            }
+        } else {
+            at = find(at, end, '<');
+        }
+        if (at == end)
+            break;
+
+        // Markup other than elements
+        if (starts_with(at, end, "<!--")) {
+            const char *close = search(at + 4, end, "-->");
+            if (!close)
+                return false;
+            at = close + 3;
+            continue;
+        }
+        if (starts_with(at, end, "<![CDATA[")) {
+            const char *close = search(at + 9, end, "]]>");
+            if (!close)
+                return false;
+            if (paragraphs)
+                append_lines(at + 9, close, out);
+            at = close + 3;
+            continue;
+        }
+        if (starts_with(at, end, "<?") || starts_with(at, end, "<!")) {
+            const char *close = find(at, end, '>');
+            if (close == end)
+                return false;
+            at = close + 1;
+            continue;
+        }
+
+        const char *close = tag_end(at + 1, end);
+        if (!close)
+            return false;
+
+        const char *name = at + 1;
+        bool closing = *name == '/';
+        if (closing)
+            name++;
+        const char *name_end = name;
+        while (name_end < close && !is_space(*name_end) && *name_end != '/')
+            name_end++;
+        bool empty = !closing && close[-1] == '/';
+        at = close + 1;
+
+        // The root element declares the prefixes of the namespaces
+        if (!bound && !closing) {
+            this->bind(name_end, close);
+            bound = true;
+        }
+
+        size_t name_size = static_cast<size_t>(name_end - name);
+        if (name_size == this->body_name.size() &&
+            memcmp(name, this->body_name.data(), name_size) == 0) {
+            in_body = !closing && !empty;
+            continue;
+        }
+        if (!in_body)
+            continue;
+
+        element kind = this->classify(name, name_size);
+        if (kind == element::paragraph || kind == element::heading) {
+            if (closing) {
+                if (paragraphs && --paragraphs == 0)
+                    out += '\n';
+            } else if (!empty) {
+                paragraphs++;
+            } else if (!paragraphs) {
+                out += '\n';
+            }
+        } else if (paragraphs && !closing) {
+            if (kind == element::tab) {
+                out += '\t';
+            } else if (kind == element::line_break) {
+                out += '\n';
+            } else if (kind == element::space) {
+                const char *count =
+                    find_attribute(name_end, close, this->space_count);
+                long spaces = count ? strtol(count, NULL, 10) : 1;
+                out.append(expanded_spaces(spaces), ' ');
+            }
+        }
+    }
+    return true;
+}
+
+bool duckx::TextExtractor::extract_package(const std::string &path,
+                                           std::string &out) {
+    zip_t *zip = zip_open(path.c_str(), ZIP_DEFAULT_COMPRESSION_LEVEL, 'r');
+    if (!zip)
+        return false;
+    bool ok = this->extract_content(zip, out);
+    zip_close(zip);
+    return ok;
+}
+
+bool duckx::TextExtractor::extract_package(const void *data, size_t size,
+                                           std::string &out) {
+    zip_t *zip = zip_stream_open(static_cast<const char *>(data), size,
+                                 ZIP_DEFAULT_COMPRESSION_LEVEL, 'r');
+    if (!zip)
+        return false;
+    bool ok = this->extract_content(zip, out);
+    zip_close(zip);
+    return ok;
+}
+
+bool duckx::TextExtractor::extract_content(zip_t *zip, std::string &out) {
+    if (zip_entry_open(zip, "content.xml") != 0)
+        return false;
+
+    size_t size = static_cast<size_t>(zip_entry_size(zip));
+    this->content.resize(size + 1);
+    bool ok = zip_entry_noallocread(zip, this->content.data(), size + 1) >= 0;
+    zip_entry_close(zip);
+    return ok && this->extract(this->content.data(), size, out);
+}
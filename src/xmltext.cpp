@@ -0,0 +1,115 @@
+#include "xmltext.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+bool duckx::is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+const char *duckx::find(const char *begin, const char *end, char c) {
+    const char *found = static_cast<const char *>(
+        memchr(begin, c, static_cast<size_t>(end - begin)));
+    return found ? found : end;
+}
+
+void duckx::append_utf8(std::string &out, unsigned long code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+const char *duckx::decode_reference(const char *amp, const char *end,
+                                    std::string &out) {
+    const char *semi = find(amp, end, ';');
+    if (semi == end) {
+        out.append(amp, end);
+        return end;
+    }
+
+    const char *entity = amp + 1;
+    size_t size = static_cast<size_t>(semi - entity);
+    if (size == 2 && memcmp(entity, "lt", 2) == 0)
+        out += '<';
+    else if (size == 2 && memcmp(entity, "gt", 2) == 0)
+        out += '>';
+    else if (size == 3 && memcmp(entity, "amp", 3) == 0)
+        out += '&';
+    else if (size == 4 && memcmp(entity, "quot", 4) == 0)
+        out += '"';
+    else if (size == 4 && memcmp(entity, "apos", 4) == 0)
+        out += '\'';
+    else if (size > 1 && entity[0] == '#')
+        append_utf8(out, entity[1] == 'x' || entity[1] == 'X'
+                             ? strtoul(entity + 2, NULL, 16)
+                             : strtoul(entity + 1, NULL, 10));
+    else
+        out.append(amp, semi + 1);
+    return semi + 1;
+}
+
+void duckx::decode(const char *text, const char *end, std::string &out) {
+    while (text < end) {
+        const char *amp = find(text, end, '&');
+        out.append(text, amp);
+        if (amp == end)
+            return;
+        text = decode_reference(amp, end, out);
+    }
+}
+
+const char *duckx::next_attribute(const char *text, const char *end,
+                                  RawAttribute &attribute) {
+    while (text < end && (is_space(*text) || *text == '/'))
+        text++;
+    attribute.name = text;
+    while (text < end && *text != '=' && !is_space(*text))
+        text++;
+    attribute.name_end = text;
+    while (text < end && *text != '"' && *text != '\'')
+        text++;
+    if (text == end)
+        return NULL;
+
+    char quote = *text++;
+    attribute.value = text;
+    while (text < end && *text != quote)
+        text++;
+    attribute.value_end = text;
+    return text < end ? text + 1 : text;
+}
+
+const char *duckx::find_attribute(const char *text, const char *end,
+                                  const std::string &name) {
+    RawAttribute attribute;
+    while ((text = next_attribute(text, end, attribute)) != NULL)
+        if (static_cast<size_t>(attribute.name_end - attribute.name) ==
+                name.size() &&
+            memcmp(attribute.name, name.data(), name.size()) == 0)
+            return attribute.value;
+    return NULL;
+}
+
+void duckx::bind_attributes(const char *text, const char *end,
+                            Names &names) {
+    names.reset();
+    RawAttribute attribute;
+    while ((text = next_attribute(text, end, attribute)) != NULL) {
+        std::string name(attribute.name, attribute.name_end);
+        std::string uri;
+        decode(attribute.value, attribute.value_end, uri);
+        names.bind(name.c_str(), uri.c_str());
+    }
+}
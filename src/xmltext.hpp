@@ -0,0 +1,51 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+#ifndef DUCKX_XMLTEXT_HPP
+#define DUCKX_XMLTEXT_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "names.hpp"
+
+namespace duckx {
+// Pieces of XML parsing shared by the readers working on the bytes of
+// content.xml (StreamReader and TextExtractor) instead of a DOM
+
+bool is_space(char);
+
+// First c in [begin, end), or end
+const char *find(const char *begin, const char *end, char c);
+
+void append_utf8(std::string &out, unsigned long code);
+
+// Append the entity or character reference at amp resolved, and return
+// what follows it
+const char *decode_reference(const char *amp, const char *end,
+                             std::string &out);
+// Append text with its entity and character references resolved
+void decode(const char *text, const char *end, std::string &out);
+
+// Attribute of a tag, as found in its bytes; the value is not decoded
+struct RawAttribute {
+    const char *name;
+    const char *name_end;
+    const char *value;
+    const char *value_end;
+};
+
+// Read the first attribute in [text, end), the bytes following the name
+// of a tag. Returns what follows the attribute, or NULL if there is none.
+const char *next_attribute(const char *text, const char *end,
+                           RawAttribute &attribute);
+// Value of an attribute in the attributes of a tag, or NULL
+const char *find_attribute(const char *text, const char *end,
+                           const std::string &name);
+// Bind the prefixes declared in the attributes of the root element
+void bind_attributes(const char *text, const char *end, Names &names);
+} // namespace duckx
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Appending saves: the changed entries are added at the end of the file,
+  unless SaveOptions::recompress asks for every entry to be written again.
+*/
+
+#include <string>
+
+#include "duckx.hpp"
+
+#include "document_test.hpp"
+
+static const char package[] = "document_append.odt";
+
+static long file_size(const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    long size = -1;
+    if (file) {
+        if (fseek(file, 0, SEEK_END) == 0)
+            size = ftell(file);
+        fclose(file);
+    }
+    return size;
+}
+
+static std::string text_of(const char *filename) {
+    duckx::Document doc(filename);
+    doc.open();
+    std::string text;
+    doc.extract_text(text);
+    return text;
+}
+
+int main(int argc, char *argv[]) {
+    test_init(argc, argv);
+
+    // Deflates to a small part of its size
+    std::string paragraphs;
+    for (int i = 0; i < 2000; i++)
+        paragraphs +=
+            "<text:p><text:span>lorem ipsum dolor</text:span></text:p>";
+    std::string expected = "changed\n";
+    for (int i = 1; i < 2000; i++)
+        expected += "lorem ipsum dolor\n";
+    CHECK(write_package(package, content_xml(paragraphs)));
+    long original = file_size(package);
+
+    // The changed content.xml is appended, the file keeps its entries
+    {
+        duckx::Document doc(package);
+        doc.open();
+        doc.paragraph_at(0).runs().set_text("changed");
+        doc.save(duckx::SaveMode::append);
+    }
+    long appended = file_size(package);
+    CHECK(appended > original);
+    CHECK(appended < 2 * original + 1024);
+    CHECK(text_of(package) == expected);
+    CHECK(unzip_test(package));
+
+    // Stored again without compression, so the whole content is written
+    // even though nothing changed
+    {
+        duckx::Document doc(package);
+        doc.open();
+        duckx::SaveOptions options;
+        options.level = 0;
+        options.recompress = true;
+        doc.set_save_options(options);
+        doc.save(duckx::SaveMode::append);
+    }
+    CHECK(file_size(package) > (long)paragraphs.size());
+    CHECK(text_of(package) == expected);
+    CHECK(unzip_test(package));
+
+    remove(package);
+    return test_result();
+}
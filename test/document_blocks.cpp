@@ -0,0 +1,129 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Document::blocks(): paragraphs and headings at every depth, in document
+  order, with the elements they are nested in; listed again once elements
+  were added or removed.
+*/
+
+#include <string>
+#include <vector>
+
+#include "duckx.hpp"
+
+#include "document_test.hpp"
+
+static const char package[] = "document_blocks.odt";
+
+static std::string p(const char *text) {
+    return std::string("<text:p><text:span>") + text +
+           "</text:span></text:p>";
+}
+
+static std::string cell(const std::string &content) {
+    return "<table:table><table:table-row><table:table-cell>" + content +
+           "</table:table-cell></table:table-row></table:table>";
+}
+
+struct Expected {
+    const char *text;
+    duckx::element kind;
+    duckx::element container;
+    unsigned depth;
+    unsigned list_level;
+    unsigned table_level;
+};
+
+static void check_blocks(const duckx::Document &doc, const Expected *expected,
+                         size_t count) {
+    const std::vector<duckx::Block> &blocks = doc.blocks();
+    CHECK(blocks.size() == count);
+    for (size_t i = 0; i < count && i < blocks.size(); i++) {
+        const duckx::Block &block = blocks[i];
+        CHECK(block.paragraph.runs().get_text() == expected[i].text);
+        CHECK(block.kind == expected[i].kind);
+        CHECK(block.container == expected[i].container);
+        CHECK(block.depth == expected[i].depth);
+        CHECK(block.list_level == expected[i].list_level);
+        CHECK(block.table_level == expected[i].table_level);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    test_init(argc, argv);
+    using duckx::element;
+
+    CHECK(write_package(
+        package,
+        content_xml(
+            "<text:h text:outline-level=\"1\"><text:span>title</text:span>"
+            "</text:h>"
+            "<text:list><text:list-item>" + p("item") +
+            "<text:list><text:list-item>" + p("nested item") +
+            "</text:list-item></text:list></text:list-item></text:list>"
+            "<text:section text:name=\"S\">" + p("section") +
+            "</text:section>" +
+            cell(p("cell") + cell(p("inner cell"))) +
+            "<table:table><table:table-row><table:covered-table-cell>" +
+            p("covered") +
+            "</table:covered-table-cell></table:table-row></table:table>"
+            "<text:p><text:span>frame</text:span><draw:frame>"
+            "<draw:text-box>" + p("box") + "</draw:text-box></draw:frame>"
+            "</text:p>" + p("last"))));
+
+    duckx::Document doc(package);
+    doc.open();
+
+    const Expected opened[] = {
+        {"title", element::heading, element::office_text, 0, 0, 0},
+        {"item", element::paragraph, element::list_item, 2, 1, 0},
+        {"nested item", element::paragraph, element::list_item, 4, 2, 0},
+        {"section", element::paragraph, element::section, 1, 0, 0},
+        {"cell", element::paragraph, element::table_cell, 3, 0, 1},
+        {"inner cell", element::paragraph, element::table_cell, 6, 0, 2},
+        {"covered", element::paragraph, element::covered_table_cell, 3, 0, 1},
+        {"frame", element::paragraph, element::office_text, 0, 0, 0},
+        {"box", element::paragraph, element::other, 3, 0, 0},
+        {"last", element::paragraph, element::office_text, 0, 0, 0},
+    };
+    check_blocks(doc, opened, sizeof(opened) / sizeof(opened[0]));
+
+    // The text follows the same order
+    std::string text;
+    doc.extract_text(text);
+    CHECK(text == "title\nitem\nnested item\nsection\ncell\ninner cell\n"
+                  "covered\nframebox\nlast\n");
+
+    // Listed once, until the structure changes
+    const duckx::Block *first = doc.blocks().data();
+    CHECK(doc.blocks().data() == first);
+    // Paragraphs of the text are "frame" and "last"
+    doc.paragraph_at(1).runs().set_text("changed");
+    CHECK(doc.blocks().data() == first);
+    CHECK(doc.blocks().back().paragraph.runs().get_text() == "changed");
+
+    // The frame goes with its paragraph
+    duckx::Paragraph title = doc.blocks()[0].paragraph;
+    title.insert_paragraph_after("after title");
+    doc.paragraph_at(1).delete_par();
+    doc.table_at(0).row_at(0).cell_at(0).add_paragraph("added");
+    const Expected edited[] = {
+        {"title", element::heading, element::office_text, 0, 0, 0},
+        {"after title", element::paragraph, element::office_text, 0, 0, 0},
+        {"item", element::paragraph, element::list_item, 2, 1, 0},
+        {"nested item", element::paragraph, element::list_item, 4, 2, 0},
+        {"section", element::paragraph, element::section, 1, 0, 0},
+        {"cell", element::paragraph, element::table_cell, 3, 0, 1},
+        {"inner cell", element::paragraph, element::table_cell, 6, 0, 2},
+        {"added", element::paragraph, element::table_cell, 3, 0, 1},
+        {"covered", element::paragraph, element::covered_table_cell, 3, 0, 1},
+        {"changed", element::paragraph, element::office_text, 0, 0, 0},
+    };
+    check_blocks(doc, edited, sizeof(edited) / sizeof(edited[0]));
+
+    remove(package);
+    return test_result();
+}
@@ -0,0 +1,81 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Paragraphs, tables and rows by position: the lists built on first use
+  follow the elements inserted and deleted through the handles, and are
+  also built through a const document.
+*/
+
+#include <string>
+
+#include "duckx.hpp"
+
+#include "document_test.hpp"
+
+static const char package[] = "document_index.odt";
+
+static std::string paragraph_text(const duckx::Document &doc, size_t i) {
+    return doc.paragraph_at(i).runs().get_text();
+}
+
+static std::string cell_text(const duckx::Table &table, size_t row) {
+    return table.row_at(row).cell_at(0).paragraphs().runs().get_text();
+}
+
+int main(int argc, char *argv[]) {
+    test_init(argc, argv);
+    CHECK(write_package(
+        package,
+        content_xml("<text:p><text:span>p0</text:span></text:p>"
+                    "<table:table table:name=\"t0\"><table:table-row>"
+                    "<table:table-cell><text:p><text:span>r0</text:span>"
+                    "</text:p></table:table-cell></table:table-row>"
+                    "</table:table>"
+                    "<text:p><text:span>p1</text:span></text:p>"
+                    "<table:table table:name=\"t1\"/>"
+                    "<text:p><text:span>p2</text:span></text:p>")));
+
+    duckx::Document doc(package);
+    doc.open();
+    const duckx::Document &view = doc;
+
+    // Paragraphs of the cells are not at the top of the text
+    CHECK(view.paragraph_count() == 3);
+    CHECK(view.table_count() == 2);
+    CHECK(paragraph_text(view, 0) == "p0");
+    CHECK(paragraph_text(view, 2) == "p2");
+    CHECK(!view.paragraph_at(3).has_next());
+    CHECK(!view.table_at(1).rows().has_next());
+
+    // Inserted in the middle, the positions after it move up
+    doc.paragraph_at(0).insert_paragraph_after("inserted");
+    CHECK(view.paragraph_count() == 4);
+    CHECK(paragraph_text(view, 1) == "inserted");
+    CHECK(paragraph_text(view, 2) == "p1");
+    CHECK(paragraph_text(view, 3) == "p2");
+
+    // Deleted, the positions after it move down
+    doc.paragraph_at(2).delete_par();
+    CHECK(view.paragraph_count() == 3);
+    CHECK(paragraph_text(view, 0) == "p0");
+    CHECK(paragraph_text(view, 1) == "inserted");
+    CHECK(paragraph_text(view, 2) == "p2");
+    CHECK(view.table_count() == 2);
+
+    // Rows appended to a table whose rows were listed
+    duckx::Table table = view.table_at(0);
+    CHECK(table.row_count() == 1);
+    table.add_row("Row").add_cell("Cell").add_paragraph("r1");
+    CHECK(table.row_count() == 2);
+    CHECK(cell_text(table, 0) == "r0");
+    CHECK(cell_text(table, 1) == "r1");
+    table.row_at(0).delete_row();
+    CHECK(table.row_count() == 1);
+    CHECK(cell_text(view.table_at(0), 0) == "r1");
+
+    remove(package);
+    return test_result();
+}
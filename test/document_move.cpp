@@ -0,0 +1,134 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Moving documents: the package, the parsed entries and the handles go to
+  the new document, which keeps working once the old one is gone, and the
+  old one is left empty but usable.
+*/
+
+#include <utility>
+
+#include "duckx.hpp"
+
+#include "document_test.hpp"
+
+static const char first[] = "document_move_first.odt";
+static const char second[] = "document_move_second.odt";
+
+static std::string text_of(const duckx::Document &doc) {
+    std::string text;
+    doc.extract_text(text);
+    return text;
+}
+
+static std::string generator_of(const duckx::Document &doc) {
+    return doc.meta()
+        .child("office:document-meta")
+        .child("office:meta")
+        .child("meta:generator")
+        .text()
+        .as_string();
+}
+
+// The moved-from document holds nothing, and opens another file
+static void check_empty(duckx::Document &doc) {
+    CHECK(text_of(doc).empty());
+    CHECK(doc.paragraph_count() == 0);
+    CHECK(doc.blocks().empty());
+    doc.file(second);
+    doc.open();
+    CHECK(text_of(doc) == "other\n");
+}
+
+static void test_move_construct() {
+    duckx::Document moved;
+    duckx::Paragraph paragraph;
+    {
+        duckx::Document doc(first);
+        doc.open();
+        paragraph = doc.paragraph_at(0);
+        moved = duckx::Document(std::move(doc));
+        check_empty(doc);
+    }
+
+    // The handle follows the content, and the pages added by the edit
+    // come from the arena that came along with it
+    CHECK(text_of(moved) == "one\ntwo\n");
+    paragraph.add_run(" more");
+    moved.paragraph_at(1).insert_paragraph_after("three");
+    CHECK(text_of(moved) == "one more\ntwo\nthree\n");
+    CHECK(moved.paragraph_count() == 3);
+
+    // meta.xml was not loaded yet: it is read with the reader that came
+    // along, and copied as it is on save
+    CHECK(generator_of(moved) == "duckx tests");
+    std::vector<char> buffer;
+    moved.save_to_buffer(buffer);
+
+    duckx::Document reopened;
+    reopened.open_from_memory(buffer.data(), buffer.size());
+    CHECK(text_of(reopened) == "one more\ntwo\nthree\n");
+    CHECK(generator_of(reopened) == "duckx tests");
+}
+
+static void test_move_assign() {
+    duckx::Document doc(first);
+    doc.open();
+    duckx::Document other(second);
+    other.open();
+    // A part of the document assigned over, loaded into the arena it drops
+    CHECK(generator_of(other) == "duckx tests");
+
+    other = std::move(doc);
+    CHECK(text_of(other) == "one\ntwo\n");
+    CHECK(other.paragraph_at(1).runs().get_text() == "two");
+    other.paragraph_at(1).runs().set_text("changed");
+    CHECK(text_of(other) == "one\nchanged\n");
+    CHECK(other.modified());
+    check_empty(doc);
+
+    // Assigning back and forth keeps both documents whole
+    std::swap(doc, other);
+    CHECK(text_of(doc) == "one\nchanged\n");
+    CHECK(text_of(other) == "other\n");
+    other = std::move(other);
+    CHECK(text_of(other) == "other\n");
+}
+
+static void test_move_mapped() {
+    duckx::Document doc(first);
+    doc.open_mapped();
+    duckx::Document moved(std::move(doc));
+
+    // The entries are still inflated from the mapping, which came along
+    CHECK(text_of(moved) == "one\ntwo\n");
+    CHECK(generator_of(moved) == "duckx tests");
+    CHECK(doc.stored_entry("mimetype").size == 0);
+
+    std::vector<char> buffer;
+    moved.save_to_buffer(buffer);
+    duckx::Document reopened;
+    reopened.open_from_memory(buffer.data(), buffer.size());
+    CHECK(text_of(reopened) == "one\ntwo\n");
+}
+
+int main(int argc, char *argv[]) {
+    test_init(argc, argv);
+    CHECK(write_package(
+        first, content_xml("<text:p><text:span>one</text:span></text:p>"
+                           "<text:p><text:span>two</text:span></text:p>")));
+    CHECK(write_package(second,
+                        content_xml("<text:p><text:span>other</text:span>"
+                                    "</text:p>")));
+
+    test_move_construct();
+    test_move_assign();
+    test_move_mapped();
+
+    remove(first);
+    remove(second);
+    return test_result();
+}
@@ -0,0 +1,144 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Documents binding the ODF namespaces to other prefixes than the usual
+  ones: elements are found by namespace, and the elements and attributes
+  added to the document are written with the prefixes of the document.
+*/
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "duckx.hpp"
+
+#include "document_test.hpp"
+
+static const char package[] = "document_names.odt";
+
+#define OFFICE_URI "urn:oasis:names:tc:opendocument:xmlns:office:1.0"
+#define TEXT_URI "urn:oasis:names:tc:opendocument:xmlns:text:1.0"
+#define TABLE_URI "urn:oasis:names:tc:opendocument:xmlns:table:1.0"
+
+static std::string text_of(const duckx::Document &doc) {
+    std::string text;
+    doc.extract_text(text);
+    return text;
+}
+
+// content.xml of a saved package, as written
+static std::string content_of(const std::vector<char> &buffer) {
+    std::string content;
+    struct zip_t *zip =
+        zip_stream_open(buffer.data(), buffer.size(), 0, 'r');
+    if (!zip)
+        return content;
+    void *data = NULL;
+    size_t size = 0;
+    if (zip_entry_open(zip, "content.xml") == 0 &&
+        zip_entry_read(zip, &data, &size) >= 0)
+        content.assign(static_cast<const char *>(data), size);
+    free(data);
+    zip_entry_close(zip);
+    zip_close(zip);
+    return content;
+}
+
+static bool contains(const std::string &text, const char *part) {
+    return text.find(part) != std::string::npos;
+}
+
+// The text of the DOM is also the text of the extractor
+static void check_extractor(const std::vector<char> &buffer,
+                            const std::string &expected) {
+    duckx::TextExtractor extractor;
+    std::string text;
+    CHECK(extractor.extract_package(buffer.data(), buffer.size(), text));
+    CHECK(text == expected);
+}
+
+// Other prefixes, and "text" bound to another namespace altogether
+static void test_prefixes() {
+    CHECK(write_package(
+        package,
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+        "<o:document-content xmlns:o=\"" OFFICE_URI "\" xmlns:t=\"" TEXT_URI
+        "\" xmlns:tb=\"" TABLE_URI "\" xmlns:text=\"urn:example:other\" "
+        "o:version=\"1.2\"><o:automatic-styles/><o:body><o:text>"
+        "<t:p>one<t:s t:c=\"2\"/>x</t:p><text:p>not a paragraph</text:p>"
+        "<tb:table><tb:table-row><tb:table-cell><t:p>cell</t:p>"
+        "</tb:table-cell></tb:table-row></tb:table>"
+        "</o:text></o:body></o:document-content>"));
+
+    duckx::Document doc(package);
+    doc.open();
+    CHECK(doc.paragraph_count() == 1);
+    CHECK(doc.table_count() == 1);
+    CHECK(doc.table_at(0).row_at(0).cell_count() == 1);
+    CHECK(text_of(doc) == "one  x\ncell\n");
+
+    doc.paragraph_at(0).add_run("added", "T1");
+    doc.paragraph_at(0).insert_paragraph_after("new");
+    std::string expected = "one  xadded\nnew\ncell\n";
+    CHECK(text_of(doc) == expected);
+    CHECK(doc.paragraph_count() == 2);
+
+    std::vector<char> buffer;
+    doc.save_to_buffer(buffer);
+    std::string content = content_of(buffer);
+    CHECK(contains(content, "<t:span t:style-name=\"T1\">added</t:span>"));
+    CHECK(contains(content, "<t:p>"));
+    CHECK(!contains(content, "<text:span"));
+
+    duckx::Document reopened;
+    reopened.open_from_memory(buffer.data(), buffer.size());
+    CHECK(text_of(reopened) == expected);
+    check_extractor(buffer, expected);
+
+    duckx::StreamReader reader;
+    CHECK(reader.open(buffer.data(), buffer.size()));
+    CHECK(reader.next() == duckx::StreamReader::Event::paragraph_begin);
+    CHECK(reader.name() == "t:p");
+    reader.close();
+}
+
+// The text namespace as the default namespace: elements go without a
+// prefix, attributes get one declared on the root element
+static void test_default_namespace() {
+    CHECK(write_package(
+        package,
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+        "<office:document-content xmlns:office=\"" OFFICE_URI
+        "\" xmlns=\"" TEXT_URI "\" office:version=\"1.2\">"
+        "<office:automatic-styles/><office:body><office:text>"
+        "<p>one</p><h>two</h></office:text></office:body>"
+        "</office:document-content>"));
+
+    duckx::Document doc(package);
+    doc.open();
+    CHECK(doc.paragraph_count() == 1);
+    CHECK(text_of(doc) == "one\ntwo\n");
+
+    doc.paragraph_at(0).add_run("added", "T1");
+    std::vector<char> buffer;
+    doc.save_to_buffer(buffer);
+    std::string content = content_of(buffer);
+    CHECK(contains(content, "xmlns:text=\"" TEXT_URI "\""));
+    CHECK(contains(content, "<span text:style-name=\"T1\">added</span>"));
+
+    duckx::Document reopened;
+    reopened.open_from_memory(buffer.data(), buffer.size());
+    CHECK(text_of(reopened) == "oneadded\ntwo\n");
+    check_extractor(buffer, "oneadded\ntwo\n");
+}
+
+int main(int argc, char *argv[]) {
+    test_init(argc, argv);
+    test_prefixes();
+    test_default_namespace();
+    remove(package);
+    return test_result();
+}
@@ -0,0 +1,74 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Helpers of the document tests: small ODF packages written with the
+  bundled zip library, so that every test starts from a content.xml it
+  spells out itself.
+*/
+
+#ifndef DOCUMENT_TEST_HPP
+#define DOCUMENT_TEST_HPP
+
+#include <string>
+
+#include "zip.h"
+#include "zip_test.h"
+
+// The usual prefixes of the namespaces used in content.xml
+static const char odf_namespaces[] =
+    "xmlns:office=\"urn:oasis:names:tc:opendocument:xmlns:office:1.0\" "
+    "xmlns:style=\"urn:oasis:names:tc:opendocument:xmlns:style:1.0\" "
+    "xmlns:text=\"urn:oasis:names:tc:opendocument:xmlns:text:1.0\" "
+    "xmlns:table=\"urn:oasis:names:tc:opendocument:xmlns:table:1.0\" "
+    "xmlns:draw=\"urn:oasis:names:tc:opendocument:xmlns:drawing:1.0\" "
+    "xmlns:xlink=\"http://www.w3.org/1999/xlink\"";
+
+// content.xml with the given office:text, bound to the usual prefixes
+static std::string content_xml(const std::string &text) {
+    return std::string("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                       "<office:document-content ") +
+           odf_namespaces +
+           " office:version=\"1.2\"><office:automatic-styles/>"
+           "<office:body><office:text>" +
+           text + "</office:text></office:body></office:document-content>";
+}
+
+static bool write_entry(struct zip_t *zip, const char *name,
+                        const std::string &data) {
+    bool ok = zip_entry_open(zip, name) == 0 &&
+              zip_entry_write(zip, data.data(), data.size()) == 0;
+    return zip_entry_close(zip) == 0 && ok;
+}
+
+// A text document package around the given content.xml
+static bool write_package(const char *path, const std::string &content) {
+    static const char manifest[] =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?><manifest:manifest "
+        "xmlns:manifest=\"urn:oasis:names:tc:opendocument:xmlns:manifest:1.0\">"
+        "<manifest:file-entry manifest:full-path=\"/\" manifest:media-type="
+        "\"application/vnd.oasis.opendocument.text\"/>"
+        "<manifest:file-entry manifest:full-path=\"content.xml\" "
+        "manifest:media-type=\"text/xml\"/></manifest:manifest>";
+    static const char meta[] =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?><office:document-meta "
+        "xmlns:office=\"urn:oasis:names:tc:opendocument:xmlns:office:1.0\" "
+        "xmlns:meta=\"urn:oasis:names:tc:opendocument:xmlns:meta:1.0\" "
+        "office:version=\"1.2\"><office:meta><meta:generator>duckx tests"
+        "</meta:generator></office:meta></office:document-meta>";
+
+    struct zip_t *zip = zip_open(path, ZIP_DEFAULT_COMPRESSION_LEVEL, 'w');
+    if (!zip)
+        return false;
+    bool ok = write_entry(zip, "mimetype",
+                          "application/vnd.oasis.opendocument.text") &&
+              write_entry(zip, "content.xml", content) &&
+              write_entry(zip, "meta.xml", meta) &&
+              write_entry(zip, "META-INF/manifest.xml", manifest);
+    zip_close(zip);
+    return ok;
+}
+
+#endif
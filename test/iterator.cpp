@@ -0,0 +1,109 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Iterator over the handles: the requirements of forward iterators, so
+  that the elements can be walked several times and given to the
+  algorithms of the standard library.
+*/
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <type_traits>
+
+#include "duckx.hpp"
+
+#include "document_test.hpp"
+
+static const char package[] = "iterator.odt";
+
+typedef duckx::Iterator<duckx::Paragraph> ParagraphIterator;
+
+static_assert(std::is_same<std::iterator_traits<ParagraphIterator>::
+                               iterator_category,
+                           std::forward_iterator_tag>::value,
+              "forward iterator");
+static_assert(std::is_default_constructible<ParagraphIterator>::value,
+              "default constructible");
+static_assert(std::is_copy_constructible<ParagraphIterator>::value &&
+                  std::is_copy_assignable<ParagraphIterator>::value,
+              "copyable");
+static_assert(std::is_same<decltype(*std::declval<ParagraphIterator>()),
+                           const duckx::Paragraph &>::value,
+              "reference to the handle");
+static_assert(std::is_same<decltype(std::declval<ParagraphIterator &>()++),
+                           ParagraphIterator>::value,
+              "postfix increment returns the previous iterator");
+
+static std::string text(const duckx::Paragraph &paragraph) {
+    return paragraph.runs().get_text();
+}
+
+int main(int argc, char *argv[]) {
+    test_init(argc, argv);
+    CHECK(write_package(
+        package,
+        content_xml("<text:p><text:span>a</text:span></text:p>"
+                    "<table:table><table:table-row><table:table-cell>"
+                    "<text:p/></table:table-cell><table:table-cell>"
+                    "<text:p/></table:table-cell></table:table-row>"
+                    "<table:table-row/></table:table>"
+                    "<text:p><text:span>b</text:span><text:span>c"
+                    "</text:span></text:p>"
+                    "<text:p><text:span>d</text:span></text:p>")));
+
+    duckx::Document doc(package);
+    doc.open();
+    const duckx::Paragraph &paragraphs = doc.paragraphs();
+
+    // Value-initialized iterators are equal, as are the ends of a range
+    CHECK(ParagraphIterator() == ParagraphIterator());
+    CHECK(duckx::end(paragraphs) == duckx::end(paragraphs));
+    CHECK(duckx::begin(paragraphs) == duckx::begin(paragraphs));
+    CHECK(duckx::begin(paragraphs) != duckx::end(paragraphs));
+
+    // Multipass: a copy keeps its position while the other one moves on
+    ParagraphIterator it = duckx::begin(paragraphs);
+    ParagraphIterator copy = it;
+    ++it;
+    CHECK(text(*copy) == "a");
+    CHECK(text(*it) == "b");
+    CHECK(it != copy);
+    ParagraphIterator previous = it++;
+    CHECK(text(*previous) == "b");
+    CHECK(text(*it) == "d");
+    CHECK(it->has_next());
+    ++it;
+    CHECK(it == duckx::end(paragraphs));
+    ++copy;
+    ++copy;
+    CHECK(text(*copy) == "d");
+
+    // Only the paragraphs of the text, not the ones in the cells
+    CHECK(std::distance(duckx::begin(paragraphs), duckx::end(paragraphs)) ==
+          3);
+    std::string all;
+    for (const duckx::Paragraph &paragraph : paragraphs)
+        all += text(paragraph);
+    CHECK(all == "abd");
+    ParagraphIterator found =
+        std::find_if(duckx::begin(paragraphs), duckx::end(paragraphs),
+                     [](const duckx::Paragraph &p) { return text(p) == "d"; });
+    CHECK(found != duckx::end(paragraphs) && !std::next(found)->has_next());
+
+    // The other handles, and ranges with no element
+    duckx::Run runs = doc.paragraph_at(1).runs();
+    CHECK(std::distance(duckx::begin(runs), duckx::end(runs)) == 2);
+    duckx::TableRow rows = doc.table_at(0).rows();
+    CHECK(std::distance(duckx::begin(rows), duckx::end(rows)) == 2);
+    duckx::TableCell cells = rows.cells();
+    CHECK(std::distance(duckx::begin(cells), duckx::end(cells)) == 2);
+    duckx::TableCell none = doc.table_at(0).row_at(1).cells();
+    CHECK(duckx::begin(none) == duckx::end(none));
+
+    remove(package);
+    return test_result();
+}
@@ -0,0 +1,82 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Merge: placeholders whole in a text node or split over several runs are
+  found once, and filled from one record after another.
+*/
+
+#include <string>
+#include <vector>
+
+#include "duckx.hpp"
+
+#include "document_test.hpp"
+
+static const char package[] = "merge_fields.odt";
+
+static std::string text_of(const duckx::Document &doc) {
+    std::string text;
+    doc.extract_text(text);
+    return text;
+}
+
+int main(int argc, char *argv[]) {
+    test_init(argc, argv);
+    CHECK(write_package(
+        package,
+        content_xml("<text:p>Dear {{name}},</text:p>"
+                    "<text:p><text:span>{{</text:span><text:span>na"
+                    "</text:span>me}} owes {{amo<text:span>unt</text:span>}}."
+                    "</text:p>"
+                    "<text:p><text:span>{{name}}</text:span></text:p>")));
+
+    duckx::Document doc(package);
+    doc.open();
+    std::string original = text_of(doc);
+    CHECK(original == "Dear {{name}},\n{{name}} owes {{amount}}.\n"
+                      "{{name}}\n");
+
+    duckx::Merge merge(doc);
+    CHECK(merge.size() == 4);
+    CHECK(merge.fields().size() == 2 && merge.fields()[0] == "name" &&
+          merge.fields()[1] == "amount");
+
+    duckx::Merge::Record record;
+    record["name"] = "Ann";
+    record["amount"] = "5";
+    merge.fill(record);
+    CHECK(text_of(doc) == "Dear Ann,\nAnn owes 5.\nAnn\n");
+
+    // A missing field keeps its placeholder, values are taken as they are
+    duckx::Merge::Record partial;
+    partial["name"] = "Bob & {{Co}}";
+    merge.fill(partial);
+    CHECK(text_of(doc) == "Dear Bob & {{Co}},\n"
+                          "Bob & {{Co}} owes {{amount}}.\n"
+                          "Bob & {{Co}}\n");
+
+    // The empty record gives the template back
+    merge.fill(duckx::Merge::Record());
+    CHECK(text_of(doc) == original);
+
+    // One package per record, each read back on its own
+    std::vector<duckx::Merge::Record> records(2, record);
+    records[1]["name"] = "Eve";
+    std::vector<std::vector<char> > outputs;
+    merge.merge(records, outputs);
+    CHECK(outputs.size() == 2);
+    if (outputs.size() == 2) {
+        duckx::Document first;
+        first.open_from_memory(outputs[0].data(), outputs[0].size());
+        CHECK(text_of(first) == "Dear Ann,\nAnn owes 5.\nAnn\n");
+        duckx::Document second;
+        second.open_from_memory(outputs[1].data(), outputs[1].size());
+        CHECK(text_of(second) == "Dear Eve,\nEve owes 5.\nEve\n");
+    }
+
+    remove(package);
+    return test_result();
+}
@@ -0,0 +1,125 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  StreamReader: the events of paragraphs, tables, rows and cells come in
+  document order, with the text of the paragraphs in between.
+*/
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "duckx.hpp"
+
+#include "document_test.hpp"
+
+static const char package[] = "stream_reader.odt";
+
+typedef duckx::StreamReader::Event Event;
+
+// One line per event: begin and end events with their element, text
+// events with their text in brackets
+static std::string events_of(duckx::StreamReader &reader) {
+    std::string events;
+    for (;;) {
+        Event event = reader.next();
+        switch (event) {
+        case Event::end:
+            return events + "end\n";
+        case Event::error:
+            return events + "error\n";
+        case Event::text:
+            events += "[" + reader.text() + "]\n";
+            break;
+        case Event::paragraph_begin:
+        case Event::table_begin:
+        case Event::row_begin:
+        case Event::cell_begin:
+            events += "<" + reader.name() + ">\n";
+            break;
+        default:
+            events += "</" + reader.name() + ">\n";
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    test_init(argc, argv);
+    std::string content = content_xml(
+        "<text:h text:outline-level=\"1\">Title</text:h>outside"
+        "<text:p text:style-name=\"P&amp;1\">a<text:s text:c=\"2\"/>b"
+        "<text:tab/><text:span>c</text:span><text:line-break/>&lt;d&gt;"
+        "<!-- <text:p>not</text:p> --><![CDATA[<e>]]></text:p>"
+        "<table:table table:name=\"T\"><table:table-row><table:table-cell>"
+        "<text:p>cell</text:p></table:table-cell><table:covered-table-cell/>"
+        "</table:table-row></table:table><text:p/>");
+    CHECK(write_package(package, content));
+
+    const char *expected = "<text:h>\n"
+                           "[Title]\n"
+                           "</text:h>\n"
+                           "<text:p>\n"
+                           "[a]\n"
+                           "[  ]\n"
+                           "[b]\n"
+                           "[\t]\n"
+                           "[c]\n"
+                           "[\n]\n"
+                           "[<d>]\n"
+                           "[<e>]\n"
+                           "</text:p>\n"
+                           "<table:table>\n"
+                           "<table:table-row>\n"
+                           "<table:table-cell>\n"
+                           "<text:p>\n"
+                           "[cell]\n"
+                           "</text:p>\n"
+                           "</table:table-cell>\n"
+                           "<table:covered-table-cell>\n"
+                           "</table:covered-table-cell>\n"
+                           "</table:table-row>\n"
+                           "</table:table>\n"
+                           "<text:p>\n"
+                           "</text:p>\n"
+                           "end\n";
+
+    duckx::StreamReader reader;
+    CHECK(reader.open(std::string(package)));
+    CHECK(events_of(reader) == expected);
+    // The reader stays at the end
+    CHECK(reader.next() == Event::end);
+
+    // Attributes of begin events, decoded
+    CHECK(reader.open(std::string(package)));
+    CHECK(reader.next() == Event::paragraph_begin);
+    CHECK(reader.attribute("text:outline-level") == "1");
+    CHECK(reader.next() == Event::text);
+    CHECK(reader.next() == Event::paragraph_end);
+    CHECK(reader.next() == Event::paragraph_begin);
+    CHECK(reader.attribute("text:style-name") == "P&1");
+    CHECK(reader.attribute("text:missing").empty());
+    reader.close();
+
+    // The same events from the package in memory
+    std::ifstream file(package, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+    CHECK(reader.open(bytes.data(), bytes.size()));
+    CHECK(events_of(reader) == expected);
+    reader.close();
+
+    // content.xml cut in the middle of a tag
+    std::string cut = content.substr(0, content.find("<table:")) + "<table:t";
+    CHECK(write_package(package, cut));
+    CHECK(reader.open(std::string(package)));
+    std::string events = events_of(reader);
+    CHECK(events.size() >= 6 &&
+          events.compare(events.size() - 6, 6, "error\n") == 0);
+
+    remove(package);
+    return test_result();
+}
@@ -0,0 +1,102 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  StreamWriter: the package written from a template opens with Document,
+  with the added paragraphs and tables after the text of the template and
+  the other entries of the template copied.
+*/
+
+#include <string>
+#include <vector>
+
+#include "duckx.hpp"
+
+#include "document_test.hpp"
+
+static const char template_package[] = "stream_writer_template.odt";
+static const char output[] = "stream_writer.odt";
+
+static std::string cell_text(const duckx::Table &table, size_t row,
+                             size_t cell) {
+    return table.row_at(row).cell_at(cell).paragraphs().runs().get_text();
+}
+
+int main(int argc, char *argv[]) {
+    test_init(argc, argv);
+    CHECK(write_package(template_package,
+                        content_xml("<text:p><text:span>intro</text:span>"
+                                    "</text:p>")));
+
+    duckx::StreamWriter writer;
+    CHECK(writer.open(template_package, output));
+    CHECK(writer.is_open());
+    writer.add_paragraph("P1");
+    writer.add_run("a & <b>", "T1");
+    writer.add_run(" \"c\"");
+    writer.add_table("Table1");
+    writer.add_column(std::vector<std::string>(2, "Column1"));
+    writer.add_row();
+    writer.add_cell("Cell1");
+    writer.add_run("r0c0");
+    writer.add_cell();
+    writer.add_run("r0c1");
+    writer.add_row();
+    writer.add_cell();
+    writer.add_run("r1c0");
+    writer.end_table();
+    // A run after the table starts a paragraph of its own
+    writer.add_run("after");
+    CHECK(writer.close());
+    CHECK(!writer.is_open());
+    CHECK(unzip_test(output));
+
+    duckx::Document doc(output);
+    doc.open();
+    std::string text;
+    doc.extract_text(text);
+    CHECK(text == "intro\na & <b> \"c\"\nr0c0\nr0c1\nr1c0\nafter\n");
+
+    CHECK(doc.paragraph_count() == 3);
+    CHECK(doc.paragraph_at(1).runs().get_text() == "a & <b>");
+    CHECK(doc.table_count() == 1);
+    duckx::Table table = doc.table_at(0);
+    CHECK(table.row_count() == 2);
+    CHECK(table.row_at(0).cell_count() == 2);
+    CHECK(table.row_at(1).cell_count() == 1);
+    CHECK(cell_text(table, 0, 0) == "r0c0");
+    CHECK(cell_text(table, 0, 1) == "r0c1");
+    CHECK(cell_text(table, 1, 0) == "r1c0");
+
+    // Styles are written with the prefixes of the template
+    typedef duckx::StreamReader::Event Event;
+    duckx::StreamReader reader;
+    CHECK(reader.open(std::string(output)));
+    CHECK(reader.next() == Event::paragraph_begin);
+    CHECK(reader.attribute("text:style-name").empty());
+    CHECK(reader.next() == Event::text);
+    CHECK(reader.next() == Event::paragraph_end);
+    CHECK(reader.next() == Event::paragraph_begin);
+    CHECK(reader.attribute("text:style-name") == "P1");
+    CHECK(reader.next() == Event::text);
+    CHECK(reader.text() == "a & <b>");
+    CHECK(reader.next() == Event::text);
+    CHECK(reader.next() == Event::paragraph_end);
+    CHECK(reader.next() == Event::table_begin);
+    CHECK(reader.attribute("table:style-name") == "Table1");
+    reader.close();
+
+    // The other entries of the template are copied
+    CHECK(std::string(doc.meta()
+                          .child("office:document-meta")
+                          .child("office:meta")
+                          .child("meta:generator")
+                          .text()
+                          .as_string()) == "duckx tests");
+
+    remove(template_package);
+    remove(output);
+    return test_result();
+}
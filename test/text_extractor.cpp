@@ -0,0 +1,87 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  TextExtractor against Document::extract_text(): both give the same text
+  for the same package, whatever the markup around the paragraphs.
+*/
+
+#include <string>
+
+#include "duckx.hpp"
+
+#include "document_test.hpp"
+
+static const char package[] = "text_extractor.odt";
+
+// The text of the DOM, which the extractor must agree with
+static std::string dom_text(const char *filename) {
+    duckx::Document doc(filename);
+    doc.open();
+    std::string text;
+    doc.extract_text(text);
+    return text;
+}
+
+static void check_same(const std::string &content, const char *expected) {
+    CHECK(write_package(package, content));
+    std::string dom = dom_text(package);
+    CHECK(dom == expected);
+
+    duckx::TextExtractor extractor;
+    std::string text;
+    CHECK(extractor.extract_package(package, text));
+    CHECK(text == dom);
+
+    text.clear();
+    CHECK(extractor.extract(content.data(), content.size(), text));
+    CHECK(text == dom);
+}
+
+int main(int argc, char *argv[]) {
+    test_init(argc, argv);
+
+    // Spaces, tabs, line breaks and references
+    check_same(content_xml("<text:h text:outline-level=\"1\">Title</text:h>"
+                           "<text:p>a<text:s/>b<text:s text:c=\"3\"/>c"
+                           "<text:tab/>d<text:line-break/>e</text:p>"
+                           "<text:p>&lt;&amp;&gt; &#233;&#x20AC; &quot;"
+                           "</text:p><text:p/>"),
+               "Title\na b   c\td\ne\n<&> \xC3\xA9\xE2\x82\xAC \"\n\n");
+
+    // Paragraphs in lists, sections and cells, and nested in spans and
+    // frames; text between paragraphs is left out
+    check_same(content_xml("<text:list><text:list-item><text:p>item</text:p>"
+                           "</text:list-item></text:list>between"
+                           "<text:section><text:p><text:span>in</text:span>"
+                           "<text:span> <text:span>span</text:span></text:span>"
+                           "</text:p></text:section>"
+                           "<table:table><table:table-row><table:table-cell>"
+                           "<text:p>cell</text:p></table:table-cell>"
+                           "</table:table-row></table:table>"
+                           "<text:p>x<draw:frame><draw:text-box><text:p>box"
+                           "</text:p></draw:text-box></draw:frame>y</text:p>"),
+               "item\nin span\ncell\nxboxy\n");
+
+    // Comments, CDATA and line ends, normalized as by the parser
+    check_same(content_xml("<text:p>a<!-- <text:p>not</text:p> -->b"
+                           "<![CDATA[<c>\r\nd]]>\r\ne\rf</text:p>"),
+               "ab<c>\nd\ne\nf\n");
+
+    // Paragraphs outside office:body are not part of the text
+    std::string outside = content_xml("<text:p>body</text:p>");
+    outside.replace(outside.find("<office:automatic-styles/>"),
+                    sizeof("<office:automatic-styles/>") - 1,
+                    "<office:automatic-styles><style:style><text:p>style"
+                    "</text:p></style:style></office:automatic-styles>");
+    outside.replace(outside.find("</office:document-content>"),
+                    sizeof("</office:document-content>") - 1,
+                    "<office:scripts><text:p>after</text:p></office:scripts>"
+                    "</office:document-content>");
+    check_same(outside, "body\n");
+
+    remove(package);
+    return test_result();
+}
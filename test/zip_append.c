@@ -0,0 +1,168 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Appending saves: entries replaced with zip_entry_drop and written again
+  at the end of the archive, and the archive cut by zip_close when its new
+  central directory is shorter than the old one.
+*/
+
+#include "zip.h"
+
+#include "zip_test.h"
+
+#define ENTRY_COUNT 20
+
+static void entry_name(char *name, size_t size, int i) {
+  snprintf(name, size, "entry%02d.txt", i);
+}
+
+static long file_size(const char *filename) {
+  FILE *file = fopen(filename, "rb");
+  long size = -1;
+
+  if (file) {
+    if (fseek(file, 0, SEEK_END) == 0) {
+      size = ftell(file);
+    }
+    fclose(file);
+  }
+  return size;
+}
+
+// Whether the archive ends right after its end of central directory record,
+// as it does when nothing is left of an older, longer central directory
+static int ends_with_directory(const char *zipname) {
+  unsigned char record[22];
+  FILE *file = fopen(zipname, "rb");
+  int ok = 0;
+
+  if (!file) {
+    return 0;
+  }
+  if (fseek(file, -(long)sizeof(record), SEEK_END) == 0 &&
+      fread(record, 1, sizeof(record), file) == sizeof(record)) {
+    // Signature, and no comment after the record
+    ok = record[0] == 'P' && record[1] == 'K' && record[2] == 5 &&
+         record[3] == 6 && record[20] == 0 && record[21] == 0;
+  }
+  fclose(file);
+  return ok;
+}
+
+static int write_entry(struct zip_t *zip, const char *name, const char *data,
+                       size_t size) {
+  int status = zip_entry_open(zip, name);
+  if (status == 0) {
+    status = zip_entry_write(zip, data, size);
+  }
+  return zip_entry_close(zip) == 0 ? status : -1;
+}
+
+static void check_entry(struct zip_t *zip, const char *zipname,
+                        const char *entryname, const char *data,
+                        size_t size) {
+  void *read = NULL;
+  size_t read_size = 0;
+
+  CHECK(zip_entry_open(zip, entryname) == 0);
+  CHECK(zip_entry_read(zip, &read, &read_size) >= 0);
+  CHECK(read_size == size && (!size || memcmp(read, data, size) == 0));
+  free(read);
+  zip_entry_close(zip);
+
+  CHECK(unzip_equals(zipname, entryname, data, size));
+}
+
+int main(int argc, char *argv[]) {
+  const char *zipname = "zip_append.zip";
+  const size_t size = 5000;
+  char *texts[ENTRY_COUNT];
+  char *content = make_text(100000, 100);
+  char *replaced = make_text(200, 101);
+  char name[32];
+  struct zip_t *zip;
+  long before;
+  int i;
+
+  test_init(argc, argv);
+  for (i = 0; i < ENTRY_COUNT; i++) {
+    texts[i] = make_text(size, (unsigned)i + 1);
+  }
+
+  zip = zip_open(zipname, ZIP_DEFAULT_COMPRESSION_LEVEL, 'w');
+  CHECK(zip != NULL);
+  CHECK(write_entry(zip, "content.xml", content, 100000) == 0);
+  for (i = 0; i < ENTRY_COUNT; i++) {
+    entry_name(name, sizeof(name), i);
+    CHECK(write_entry(zip, name, texts[i], size) == 0);
+  }
+  zip_close(zip);
+
+  // Replace content.xml twice, each time by dropping it and appending it
+  // again; the entry keeps a single place in the central directory
+  zip = zip_open(zipname, ZIP_DEFAULT_COMPRESSION_LEVEL, 'a');
+  CHECK(zip != NULL);
+  CHECK(zip_entry_drop(zip, "content.xml") == 0);
+  CHECK(write_entry(zip, "content.xml", replaced, 200) == 0);
+  zip_close(zip);
+
+  zip = zip_open(zipname, ZIP_DEFAULT_COMPRESSION_LEVEL, 'a');
+  CHECK(zip != NULL);
+  CHECK(zip_entry_drop(zip, "content.xml") == 0);
+  CHECK(write_entry(zip, "content.xml", content, 1000) == 0);
+  // Only entries of the archive can be dropped
+  CHECK(zip_entry_drop(zip, "missing.xml") < 0);
+  zip_close(zip);
+
+  CHECK(unzip_test(zipname));
+  CHECK(ends_with_directory(zipname));
+
+  zip = zip_open(zipname, 0, 'r');
+  CHECK(zip != NULL);
+  CHECK(zip_total_entries(zip) == ENTRY_COUNT + 1);
+  check_entry(zip, zipname, "content.xml", content, 1000);
+  for (i = 0; i < ENTRY_COUNT; i++) {
+    entry_name(name, sizeof(name), i);
+    check_entry(zip, zipname, name, texts[i], size);
+  }
+  zip_close(zip);
+
+  // Dropping entries without writing new ones leaves a shorter central
+  // directory where the old one started, and the file has to be cut there
+  before = file_size(zipname);
+  zip = zip_open(zipname, ZIP_DEFAULT_COMPRESSION_LEVEL, 'a');
+  CHECK(zip != NULL);
+  for (i = 0; i < ENTRY_COUNT; i += 2) {
+    entry_name(name, sizeof(name), i);
+    CHECK(zip_entry_drop(zip, name) == 0);
+  }
+  zip_close(zip);
+
+  CHECK(file_size(zipname) < before);
+  CHECK(unzip_test(zipname));
+  CHECK(ends_with_directory(zipname));
+
+  zip = zip_open(zipname, 0, 'r');
+  CHECK(zip != NULL);
+  CHECK(zip_total_entries(zip) == ENTRY_COUNT / 2 + 1);
+  check_entry(zip, zipname, "content.xml", content, 1000);
+  for (i = 0; i < ENTRY_COUNT; i++) {
+    entry_name(name, sizeof(name), i);
+    if (i % 2) {
+      check_entry(zip, zipname, name, texts[i], size);
+    } else {
+      CHECK(zip_entry_open(zip, name) < 0);
+    }
+  }
+  zip_close(zip);
+
+  for (i = 0; i < ENTRY_COUNT; i++) {
+    free(texts[i]);
+  }
+  free(content);
+  free(replaced);
+  return test_result();
+}
@@ -0,0 +1,151 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Entries written with zip_entry_write_deflated: raw deflate blocks
+  compressed on their own, as the parallel deflater of duckX does, whose
+  crc-32 values are combined by the library into the crc-32 of the entry.
+*/
+
+#define MINIZ_HEADER_FILE_ONLY
+#include "miniz.h"
+#include "zip.h"
+
+#include "zip_test.h"
+
+// Deflate size bytes as one block ending on a byte boundary, or as the
+// final block of the stream
+static void *deflate_block(tdefl_compressor *comp, const char *data,
+                           size_t size, int last, size_t *out_size) {
+  size_t capacity = size + size / 8 + 64;
+  void *out = malloc(capacity);
+  size_t in_size = size;
+
+  *out_size = capacity;
+  tdefl_init(comp, NULL, NULL,
+             (int)tdefl_create_comp_flags_from_zip_params(6, -15,
+                                                          MZ_DEFAULT_STRATEGY));
+  if (tdefl_compress(comp, data, &in_size, out, out_size,
+                     last ? TDEFL_FINISH : TDEFL_SYNC_FLUSH) !=
+          (last ? TDEFL_STATUS_DONE : TDEFL_STATUS_OKAY) ||
+      in_size != size) {
+    free(out);
+    return NULL;
+  }
+  return out;
+}
+
+// Write data to the current entry in blocks of block_size bytes, each
+// compressed from an empty dictionary
+static int write_blocks(struct zip_t *zip, tdefl_compressor *comp,
+                        const char *data, size_t size, size_t block_size,
+                        int separate_end) {
+  static const unsigned char last_block[2] = {0x03, 0x00};
+  size_t at = 0;
+
+  do {
+    size_t n = size - at < block_size ? size - at : block_size;
+    int last = !separate_end && at + n == size;
+    size_t out_size;
+    void *out = deflate_block(comp, data + at, n, last, &out_size);
+    int status;
+
+    if (!out) {
+      return -1;
+    }
+    status = zip_entry_write_deflated(
+        zip, out, out_size, n,
+        (unsigned int)mz_crc32(MZ_CRC32_INIT, (const mz_uint8 *)data + at, n));
+    free(out);
+    if (status != 0) {
+      return -1;
+    }
+    at += n;
+  } while (at < size);
+
+  // Empty final block with fixed Huffman codes, after sync flushed blocks
+  if (separate_end) {
+    return zip_entry_write_deflated(zip, last_block, sizeof(last_block), 0, 0);
+  }
+  return 0;
+}
+
+static void check_entry(struct zip_t *zip, const char *zipname,
+                        const char *entryname, const char *data,
+                        size_t size) {
+  void *read = NULL;
+  size_t read_size = 0;
+
+  CHECK(zip_entry_open(zip, entryname) == 0);
+  CHECK(zip_entry_size(zip) == size);
+  CHECK(zip_entry_crc32(zip) ==
+        (unsigned int)mz_crc32(MZ_CRC32_INIT, (const mz_uint8 *)data, size));
+  CHECK(zip_entry_read(zip, &read, &read_size) >= 0);
+  CHECK(read_size == size && (!size || memcmp(read, data, size) == 0));
+  free(read);
+  zip_entry_close(zip);
+
+  CHECK(unzip_equals(zipname, entryname, data, size));
+}
+
+int main(int argc, char *argv[]) {
+  const char *zipname = "zip_deflated.zip";
+  const size_t size = 300000;
+  char *text = make_text(size, 1);
+  tdefl_compressor *comp = (tdefl_compressor *)malloc(sizeof(tdefl_compressor));
+  struct zip_t *zip;
+
+  test_init(argc, argv);
+  if (!text || !comp) {
+    return EXIT_FAILURE;
+  }
+
+  zip = zip_open(zipname, ZIP_DEFAULT_COMPRESSION_LEVEL, 'w');
+  CHECK(zip != NULL);
+
+  // Blocks of a size that does not divide the entry, ended by an empty
+  // final block
+  CHECK(zip_entry_open(zip, "blocks.txt") == 0);
+  CHECK(write_blocks(zip, comp, text, size, 65536 + 17, 1) == 0);
+  CHECK(zip_entry_close(zip) == 0);
+
+  // The last block with data ends the stream itself
+  CHECK(zip_entry_open(zip, "last.txt") == 0);
+  CHECK(write_blocks(zip, comp, text, size, 100000, 0) == 0);
+  CHECK(zip_entry_close(zip) == 0);
+
+  // One block holding the whole entry
+  CHECK(zip_entry_open(zip, "single.txt") == 0);
+  CHECK(write_blocks(zip, comp, text, 1000, 1000, 0) == 0);
+  CHECK(zip_entry_close(zip) == 0);
+
+  // Nothing but the final block
+  CHECK(zip_entry_open(zip, "empty.txt") == 0);
+  CHECK(write_blocks(zip, comp, text, 0, 1000, 1) == 0);
+  CHECK(zip_entry_close(zip) == 0);
+
+  // Deflated data cannot follow data written with zip_entry_write
+  CHECK(zip_entry_open(zip, "mixed.txt") == 0);
+  CHECK(zip_entry_write(zip, text, 10) == 0);
+  CHECK(zip_entry_write_deflated(zip, text, 10, 10, 0) < 0);
+  CHECK(zip_entry_close(zip) == 0);
+  zip_close(zip);
+
+  CHECK(unzip_test(zipname));
+
+  zip = zip_open(zipname, 0, 'r');
+  CHECK(zip != NULL);
+  CHECK(zip_total_entries(zip) == 5);
+  check_entry(zip, zipname, "blocks.txt", text, size);
+  check_entry(zip, zipname, "last.txt", text, size);
+  check_entry(zip, zipname, "single.txt", text, 1000);
+  check_entry(zip, zipname, "empty.txt", text, 0);
+  check_entry(zip, zipname, "mixed.txt", text, 10);
+  zip_close(zip);
+
+  free(comp);
+  free(text);
+  return test_result();
+}
@@ -0,0 +1,129 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Entries read piece by piece with zip_entry_readchunk, with buffers
+  smaller and larger than the 64 KiB the input is read in and the 32 KiB
+  window it is inflated through, so that pieces straddle both. Text
+  deflates to much less than 64 KiB, so noise that hardly compresses
+  makes the input run out in the middle of the window.
+*/
+
+#include "zip.h"
+
+#include "zip_test.h"
+
+static const size_t buffer_sizes[] = {1, 7, 1000, 32767, 32768, 65537, 400000};
+
+// Bytes which deflate hardly reduces
+static char *make_noise(size_t size) {
+  char *noise = (char *)malloc(size);
+  unsigned seed = 12345;
+  size_t i;
+
+  for (i = 0; noise && i < size; i++) {
+    seed = seed * 1103515245u + 12345u;
+    noise[i] = (char)(seed >> 24);
+  }
+  return noise;
+}
+
+static void write_archive(const char *zipname, int level, const char *text,
+                          size_t size, const char *noise, size_t noise_size) {
+  struct zip_t *zip = zip_open(zipname, level, 'w');
+
+  CHECK(zip != NULL);
+  CHECK(zip_entry_open(zip, "big.txt") == 0);
+  CHECK(zip_entry_write(zip, text, size) == 0);
+  CHECK(zip_entry_close(zip) == 0);
+  CHECK(zip_entry_open(zip, "noise.bin") == 0);
+  CHECK(zip_entry_write(zip, noise, noise_size) == 0);
+  CHECK(zip_entry_close(zip) == 0);
+  CHECK(zip_entry_open(zip, "small.txt") == 0);
+  CHECK(zip_entry_write(zip, text, 100) == 0);
+  CHECK(zip_entry_close(zip) == 0);
+  CHECK(zip_entry_open(zip, "empty.txt") == 0);
+  CHECK(zip_entry_close(zip) == 0);
+  zip_close(zip);
+
+  CHECK(unzip_test(zipname));
+}
+
+// Read the entry in pieces of at most bufsize bytes, then check that the
+// end of the entry is reported
+static void check_chunks(struct zip_t *zip, const char *entryname,
+                         const char *text, size_t size, size_t bufsize) {
+  char *buf = (char *)malloc(bufsize);
+  char *read = (char *)malloc(size + 1);
+  size_t total = 0;
+  ssize_t n = 0;
+
+  CHECK(zip_entry_open(zip, entryname) == 0);
+  while (buf && read &&
+         (n = zip_entry_readchunk(zip, buf, bufsize)) > 0) {
+    CHECK((size_t)n <= bufsize && total + (size_t)n <= size);
+    if ((size_t)n > size - total) {
+      break;
+    }
+    memcpy(read + total, buf, (size_t)n);
+    total += (size_t)n;
+  }
+  CHECK(n == 0);
+  CHECK(total == size && memcmp(read, text, size) == 0);
+  CHECK(zip_entry_readchunk(zip, buf, bufsize) == 0);
+  zip_entry_close(zip);
+
+  free(buf);
+  free(read);
+}
+
+static void check_archive(const char *zipname, const char *text,
+                          size_t size, const char *noise,
+                          size_t noise_size) {
+  struct zip_t *zip = zip_open(zipname, 0, 'r');
+  size_t i;
+
+  CHECK(zip != NULL);
+  for (i = 0; i < sizeof(buffer_sizes) / sizeof(buffer_sizes[0]); i++) {
+    check_chunks(zip, "big.txt", text, size, buffer_sizes[i]);
+    check_chunks(zip, "noise.bin", noise, noise_size, buffer_sizes[i]);
+    check_chunks(zip, "small.txt", text, 100, buffer_sizes[i]);
+    check_chunks(zip, "empty.txt", text, 0, buffer_sizes[i]);
+  }
+
+  // Opening the entry again starts over
+  check_chunks(zip, "big.txt", text, size, 4096);
+  zip_close(zip);
+
+  CHECK(unzip_equals(zipname, "big.txt", text, size));
+  CHECK(unzip_equals(zipname, "noise.bin", noise, noise_size));
+  CHECK(unzip_equals(zipname, "small.txt", text, 100));
+  CHECK(unzip_equals(zipname, "empty.txt", text, 0));
+}
+
+int main(int argc, char *argv[]) {
+  const size_t size = 300000;
+  const size_t noise_size = 200000;
+  char *text = make_text(size, 7);
+  char *noise = make_noise(noise_size);
+
+  test_init(argc, argv);
+  if (!text || !noise) {
+    return EXIT_FAILURE;
+  }
+
+  write_archive("zip_readchunk.zip", ZIP_DEFAULT_COMPRESSION_LEVEL, text,
+                size, noise, noise_size);
+  check_archive("zip_readchunk.zip", text, size, noise, noise_size);
+
+  // Stored entries are read as they are
+  write_archive("zip_readchunk_stored.zip", 0, text, size, noise,
+                noise_size);
+  check_archive("zip_readchunk_stored.zip", text, size, noise, noise_size);
+
+  free(text);
+  free(noise);
+  return test_result();
+}
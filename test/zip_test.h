@@ -0,0 +1,116 @@
+/*
+ * Under MIT license
+ * DuckX is a free library to work with docx files.
+ */
+
+/*
+  Helpers of the zip tests. Every test writes archives with the bundled zip
+  library and reads them back, then hands them to the unzip program given
+  as first argument, so that they are also checked by an implementation
+  that does not share any code with the one under test. Without the
+  argument only the round trip is checked.
+*/
+
+#ifndef ZIP_TEST_H
+#define ZIP_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+static int failures = 0;
+static const char *unzip_program = NULL;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,        \
+              #cond);                                                          \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+static void test_init(int argc, char *argv[]) {
+  if (argc > 1) {
+    unzip_program = argv[1];
+  }
+}
+
+static int test_result(void) {
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+  }
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Text with long and short repeats, so that it deflates to several blocks
+// of every kind
+static char *make_text(size_t size, unsigned seed) {
+  static const char *words[] = {"lorem ",   "ipsum ", "dolor ",  "sit ",
+                                "amet, ",   "<text:p>", "</text:p>\n",
+                                "&amp; ",   "\t",      "0123456789 "};
+  char *text = (char *)malloc(size ? size : 1);
+  size_t i = 0;
+
+  while (text && i < size) {
+    const char *word;
+    size_t n;
+
+    seed = seed * 1103515245u + 12345u;
+    word = words[(seed >> 16) % (sizeof(words) / sizeof(words[0]))];
+    n = strlen(word);
+    if (n > size - i) {
+      n = size - i;
+    }
+    memcpy(text + i, word, n);
+    i += n;
+  }
+  return text;
+}
+
+// Whether unzip finds no error in the archive, crc-32 included
+static int unzip_test(const char *zipname) {
+  char command[1024];
+
+  if (!unzip_program) {
+    return 1;
+  }
+  snprintf(command, sizeof(command), "\"%s\" -tqq \"%s\"", unzip_program,
+           zipname);
+  return system(command) == 0;
+}
+
+// Whether unzip extracts the entry with exactly the given bytes
+static int unzip_equals(const char *zipname, const char *entryname,
+                        const void *data, size_t size) {
+  char command[1024];
+  char chunk[4096];
+  const char *expected = (const char *)data;
+  size_t at = 0, n;
+  int same = 1;
+  FILE *pipe;
+
+  if (!unzip_program) {
+    return 1;
+  }
+  snprintf(command, sizeof(command), "\"%s\" -p \"%s\" \"%s\"", unzip_program,
+           zipname, entryname);
+  pipe = popen(command, "r");
+  if (!pipe) {
+    return 0;
+  }
+  while ((n = fread(chunk, 1, sizeof(chunk), pipe)) > 0) {
+    if (n > size - at || memcmp(chunk, expected + at, n) != 0) {
+      same = 0;
+    }
+    at += n > size - at ? size - at : n;
+  }
+  return pclose(pipe) == 0 && same && at == size;
+}
+
+#endif
@@ -437,6 +437,12 @@ PUGI__NS_BEGIN
 	static const uintptr_t xml_memory_page_value_allocated_mask = 16;
 	static const uintptr_t xml_memory_page_type_mask = 15;
 
+#ifndef PUGIXML_COMPACT
+	// application-defined node kind, in the top byte of the header
+	static const uintptr_t xml_memory_page_kind_shift = sizeof(uintptr_t) * 8 - 8;
+	static const uintptr_t xml_memory_page_kind_mask = static_cast<uintptr_t>(0xff) << xml_memory_page_kind_shift;
+#endif
+
 	// combined masks for string uniqueness
 	static const uintptr_t xml_memory_page_name_allocated_or_shared_mask = xml_memory_page_name_allocated_mask | xml_memory_page_contents_shared_mask;
 	static const uintptr_t xml_memory_page_value_allocated_or_shared_mask = xml_memory_page_value_allocated_mask | xml_memory_page_contents_shared_mask;
@@ -447,7 +453,7 @@ PUGI__NS_BEGIN
 #else
 	#define PUGI__GETHEADER_IMPL(object, page, flags) (((reinterpret_cast<char*>(object) - reinterpret_cast<char*>(page)) << 8) | (flags))
 	// this macro casts pointers through void* to avoid 'cast increases required alignment of target type' warnings
-	#define PUGI__GETPAGE_IMPL(header) static_cast<impl::xml_memory_page*>(const_cast<void*>(static_cast<const void*>(reinterpret_cast<const char*>(&header) - (header >> 8))))
+	#define PUGI__GETPAGE_IMPL(header) static_cast<impl::xml_memory_page*>(const_cast<void*>(static_cast<const void*>(reinterpret_cast<const char*>(&header) - ((header & ~impl::xml_memory_page_kind_mask) >> 8))))
 #endif
 
 	#define PUGI__GETPAGE(n) PUGI__GETPAGE_IMPL((n)->header)
@@ -507,7 +513,7 @@ PUGI__NS_BEGIN
 
 	struct xml_allocator
 	{
-		xml_allocator(xml_memory_page* root): _root(root), _busy_size(root->busy_size)
+		xml_allocator(xml_memory_page* root): _root(root), _busy_size(root->busy_size), _resource(0)
 		{
 		#ifdef PUGIXML_COMPACT
 			_hash = 0;
@@ -519,7 +525,7 @@ PUGI__NS_BEGIN
 			size_t size = sizeof(xml_memory_page) + data_size;
 
 			// allocate block with some alignment, leaving memory for worst-case padding
-			void* memory = xml_memory::allocate(size);
+			void* memory = _resource ? _resource->allocate(size) : xml_memory::allocate(size);
 			if (!memory) return 0;
 
 			// prepare page structure
@@ -533,7 +539,10 @@ PUGI__NS_BEGIN
 
 		static void deallocate_page(xml_memory_page* page)
 		{
-			xml_memory::deallocate(page);
+			xml_memory_resource* resource = page->allocator->_resource;
+
+			if (resource) resource->deallocate(page);
+			else xml_memory::deallocate(page);
 		}
 
 		void* allocate_memory_oob(size_t size, xml_memory_page*& out_page);
@@ -699,6 +708,8 @@ PUGI__NS_BEGIN
 		xml_memory_page* _root;
 		size_t _busy_size;
 
+		xml_memory_resource* _resource;
+
 	#ifdef PUGIXML_COMPACT
 		compact_hash_table* _hash;
 	#endif
@@ -4396,6 +4407,10 @@ PUGI__NS_BEGIN
 
 	PUGI__FN void node_copy_contents(xml_node_struct* dn, xml_node_struct* sn, xml_allocator* shared_alloc)
 	{
+	#ifndef PUGIXML_COMPACT
+		dn->header |= sn->header & xml_memory_page_kind_mask;
+	#endif
+
 		node_copy_string(dn->name, dn->header, xml_memory_page_name_allocated_mask, sn->name, sn->header, shared_alloc);
 		node_copy_string(dn->value, dn->header, xml_memory_page_value_allocated_mask, sn->value, sn->header, shared_alloc);
 
@@ -5631,6 +5646,10 @@ namespace pugi
 		if (type_ != node_element && type_ != node_pi && type_ != node_declaration)
 			return false;
 
+	#ifndef PUGIXML_COMPACT
+		_root->header &= ~impl::xml_memory_page_kind_mask;
+	#endif
+
 		return impl::strcpy_insitu(_root->name, _root->header, impl::xml_memory_page_name_allocated_mask, rhs, impl::strlength(rhs));
 	}
 
@@ -5644,6 +5663,28 @@ namespace pugi
 		return impl::strcpy_insitu(_root->value, _root->header, impl::xml_memory_page_value_allocated_mask, rhs, impl::strlength(rhs));
 	}
 
+	PUGI__FN unsigned int xml_node::kind() const
+	{
+	#ifdef PUGIXML_COMPACT
+		return 0;
+	#else
+		return _root ? static_cast<unsigned int>(_root->header >> impl::xml_memory_page_kind_shift) : 0;
+	#endif
+	}
+
+	PUGI__FN bool xml_node::set_kind(unsigned int rhs)
+	{
+	#ifdef PUGIXML_COMPACT
+		(void)rhs;
+		return false;
+	#else
+		if (!_root || rhs > 0xff) return false;
+
+		_root->header = (_root->header & ~impl::xml_memory_page_kind_mask) | (static_cast<uintptr_t>(rhs) << impl::xml_memory_page_kind_shift);
+		return true;
+	#endif
+	}
+
 	PUGI__FN xml_attribute xml_node::append_attribute(const char_t* name_)
 	{
 		if (!impl::allow_insert_attribute(type())) return xml_attribute();
@@ -6835,7 +6876,7 @@ namespace pugi
 		}
 	}
 
-	PUGI__FN xml_document::xml_document(): _buffer(0)
+	PUGI__FN xml_document::xml_document(): _buffer(0), _resource(0)
 	{
 		_create();
 	}
@@ -6846,7 +6887,7 @@ namespace pugi
 	}
 
 #ifdef PUGIXML_HAS_MOVE
-	PUGI__FN xml_document::xml_document(xml_document&& rhs) PUGIXML_NOEXCEPT_IF_NOT_COMPACT: _buffer(0)
+	PUGI__FN xml_document::xml_document(xml_document&& rhs) PUGIXML_NOEXCEPT_IF_NOT_COMPACT: _buffer(0), _resource(0)
 	{
 		_create();
 		_move(rhs);
@@ -6878,6 +6919,18 @@ namespace pugi
 			append_copy(cur);
 	}
 
+	PUGI__FN void xml_document::set_memory_resource(xml_memory_resource* resource)
+	{
+		_destroy();
+		_resource = resource;
+		_create();
+	}
+
+	PUGI__FN xml_memory_resource* xml_document::memory_resource() const
+	{
+		return _resource;
+	}
+
 	PUGI__FN void xml_document::_create()
 	{
 		assert(!_root);
@@ -6912,6 +6965,9 @@ namespace pugi
 		// setup sentinel page
 		page->allocator = static_cast<impl::xml_document_struct*>(_root);
 
+		// pages beyond the sentinel one come from the document resource, if any
+		page->allocator->_resource = _resource;
+
 		// setup hash table pointer in allocator
 	#ifdef PUGIXML_COMPACT
 		page->allocator->_hash = &static_cast<impl::xml_document_struct*>(_root)->hash;
@@ -6993,9 +7049,11 @@ namespace pugi
 		}
 	#endif
 
-		// move allocation state
+		// move allocation state; the pages stay with the resource they were allocated from
 		doc->_root = other->_root;
 		doc->_busy_size = other->_busy_size;
+		doc->_resource = other->_resource;
+		_resource = rhs._resource;
 
 		// move buffer state
 		doc->buffer = other->buffer;
@@ -7063,6 +7121,7 @@ namespace pugi
 
 		// reset other document
 		new (other) impl::xml_document_struct(PUGI__GETPAGE(other));
+		other->_resource = rhs._resource;
 		rhs._buffer = 0;
 	}
 #endif
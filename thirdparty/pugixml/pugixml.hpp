@@ -529,6 +529,11 @@ namespace pugi
 		bool set_name(const char_t* rhs);
 		bool set_value(const char_t* rhs);
 
+		// Get/set application-defined kind of the node, a value in 0..255 kept in the node header (0 if node is empty or never set).
+		// The kind is copied with the node and reset by set_name; with PUGIXML_COMPACT it is always 0 and set_kind returns false.
+		unsigned int kind() const;
+		bool set_kind(unsigned int rhs);
+
 		// Add attribute with specified name. Returns added attribute, or empty attribute on errors.
 		xml_attribute append_attribute(const char_t* name);
 		xml_attribute prepend_attribute(const char_t* name);
@@ -990,11 +995,26 @@ namespace pugi
 	};
 
 	// Document class (DOM tree root)
+	// Memory resource for the node and string pages of a single document, used instead of the global allocation functions
+	class PUGIXML_CLASS xml_memory_resource
+	{
+	public:
+		virtual ~xml_memory_resource() {}
+
+		// Allocate a block aligned for any type; return 0 on failure
+		virtual void* allocate(size_t size) = 0;
+
+		// Release a block returned by allocate
+		virtual void deallocate(void* ptr) = 0;
+	};
+
 	class PUGIXML_CLASS xml_document: public xml_node
 	{
 	private:
 		char_t* _buffer;
 
+		xml_memory_resource* _resource;
+
 		char _memory[192];
 
 		// Non-copyable semantics
@@ -1024,6 +1044,11 @@ namespace pugi
 		// Removes all nodes, then copies the entire contents of the specified document
 		void reset(const xml_document& proto);
 
+		// Removes all nodes, then allocates the pages of the document from the specified resource (0 restores the global allocation functions).
+		// The resource must outlive the document contents; a document moved into another one takes its resource along.
+		void set_memory_resource(xml_memory_resource* resource);
+		xml_memory_resource* memory_resource() const;
+
 	#ifndef PUGIXML_NO_STL
 		// Load document from stream.
 		xml_parse_result load(std::basic_istream<char, std::char_traits<char> >& stream, unsigned int options = parse_default, xml_encoding encoding = encoding_auto);
@@ -17,6 +17,7 @@
     defined(__MINGW32__)
 /* Win32, DOS, MSVC, MSVS */
 #include <direct.h>
+#include <io.h>
 
 #define MKDIR(DIRNAME) _mkdir(DIRNAME)
 #define STRCLONE(STR) ((STR) ? _strdup(STR) : NULL)
@@ -25,6 +26,7 @@
    (P)[1] == ':')
 #define FILESYSTEM_PREFIX_LEN(P) (HAS_DEVICE(P) ? 2 : 0)
 #define ISSLASH(C) ((C) == '/' || (C) == '\\')
+#define TRUNCATE(FILE, SIZE) _chsize_s(_fileno(FILE), (__int64)(SIZE))
 
 #else
 
@@ -33,6 +35,7 @@ int symlink(const char *target, const char *linkpath); // needed on Linux
 
 #define MKDIR(DIRNAME) mkdir(DIRNAME, 0755)
 #define STRCLONE(STR) ((STR) ? strdup(STR) : NULL)
+#define TRUNCATE(FILE, SIZE) ftruncate(fileno(FILE), (off_t)(SIZE))
 
 #endif
 
@@ -136,6 +139,23 @@ struct zip_entry_t {
   tdefl_compressor comp;
   mz_uint32 external_attr;
   time_t m_time;
+  int deflated; // the data is given already deflated
+  struct zip_entry_stream_t *stream; // state of zip_entry_readchunk
+};
+
+// An entry being inflated piece by piece, with the last 32 KiB of output
+// kept as the dictionary
+struct zip_entry_stream_t {
+  tinfl_decompressor inflator;
+  mz_uint64 comp_ofs;  // archive offset of the next compressed byte
+  mz_uint64 comp_left; // compressed bytes not read yet
+  mz_uint8 in[MZ_ZIP_MAX_IO_BUF_SIZE];
+  size_t in_ofs, in_avail;
+  mz_uint8 dict[TINFL_LZ_DICT_SIZE];
+  size_t dict_ofs;          // where the inflator writes next
+  size_t out_ofs, out_avail; // inflated bytes not handed out yet
+  mz_uint32 crc32;
+  int done;
 };
 
 struct zip_t {
@@ -206,13 +226,97 @@ void zip_close(struct zip_t *zip) {
     // valid central directory.
     mz_zip_writer_finalize_archive(&(zip->archive));
 
+    // An archive opened in 'a' mode may end up shorter than the file it was
+    // read from, cut off the tail of the old central directory
+    if (zip->archive.m_zip_mode == MZ_ZIP_MODE_WRITING_HAS_BEEN_FINALIZED &&
+        zip->archive.m_pState && zip->archive.m_pState->m_pFile) {
+      FILE *file = zip->archive.m_pState->m_pFile;
+      fflush(file);
+      if (TRUNCATE(file, zip->archive.m_archive_size) != 0) {
+        // Cannot truncate, the stale bytes stay behind the end of central
+        // directory record
+      }
+    }
+
     mz_zip_writer_end(&(zip->archive));
     mz_zip_reader_end(&(zip->archive));
 
+    CLEANUP(zip->entry.stream);
     CLEANUP(zip);
   }
 }
 
+// Empties a reader but keeps its central directory arrays
+static int zip_reader_clear(struct zip_t *zip) {
+  mz_zip_archive *pzip = NULL;
+  mz_zip_internal_state *pState = NULL;
+
+  if (!zip) {
+    // zip_t handler is not initialized
+    return -1;
+  }
+
+  pzip = &(zip->archive);
+  pState = pzip->m_pState;
+  if (!pState || pzip->m_zip_mode != MZ_ZIP_MODE_READING) {
+    // Wrong zip mode
+    return -1;
+  }
+
+  if (pState->m_pFile) {
+    MZ_FCLOSE(pState->m_pFile);
+    pState->m_pFile = NULL;
+  }
+  pState->m_pMem = NULL;
+  pState->m_mem_size = 0;
+  pState->m_central_dir.m_size = 0;
+  pState->m_central_dir_offsets.m_size = 0;
+  pState->m_sorted_central_dir_offsets.m_size = 0;
+
+  pzip->m_archive_size = 0;
+  pzip->m_central_directory_file_ofs = 0;
+  pzip->m_total_files = 0;
+  return 0;
+}
+
+// Reads the central directory of the archive a cleared reader points at
+static int zip_reader_load(struct zip_t *zip) {
+  if (!mz_zip_reader_read_central_dir(
+          &(zip->archive),
+          zip->level | MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY)) {
+    zip_reader_clear(zip);
+    return -1;
+  }
+  return 0;
+}
+
+int zip_reopen(struct zip_t *zip, const char *zipname) {
+  MZ_FILE *file = NULL;
+
+  if (zip_reader_clear(zip) < 0) {
+    return -1;
+  }
+  if (!zipname) {
+    return 0;
+  }
+
+  file = MZ_FOPEN(zipname, "rb");
+  if (!file) {
+    // An archive file does not exist
+    return -1;
+  }
+  if (MZ_FSEEK64(file, 0, SEEK_END)) {
+    MZ_FCLOSE(file);
+    return -1;
+  }
+
+  zip->archive.m_pRead = mz_zip_file_read_func;
+  zip->archive.m_pIO_opaque = &(zip->archive);
+  zip->archive.m_pState->m_pFile = file;
+  zip->archive.m_archive_size = MZ_FTELL64(file);
+  return zip_reader_load(zip);
+}
+
 int zip_entry_open(struct zip_t *zip, const char *entryname) {
   size_t entrylen = 0;
   mz_zip_archive *pzip = NULL;
@@ -227,6 +331,7 @@ int zip_entry_open(struct zip_t *zip, const char *entryname) {
   if (entrylen < 1) {
     return -1;
   }
+  CLEANUP(zip->entry.stream);
 
   /*
     .ZIP File Format Specification Version: 6.3.3
@@ -278,6 +383,7 @@ int zip_entry_open(struct zip_t *zip, const char *entryname) {
   memset(zip->entry.header, 0, MZ_ZIP_LOCAL_DIR_HEADER_SIZE * sizeof(mz_uint8));
   zip->entry.method = 0;
   zip->entry.external_attr = 0;
+  zip->entry.deflated = 0;
 
   num_alignment_padding_bytes =
       mz_zip_writer_compute_padding_needed_for_file_alignment(pzip);
@@ -432,7 +538,9 @@ int zip_entry_close(struct zip_t *zip) {
   }
 
   level = zip->level & 0xF;
-  if (level) {
+  if (zip->entry.deflated) {
+    zip->entry.method = MZ_DEFLATED;
+  } else if (level) {
     done = tdefl_compress_buffer(&(zip->entry.comp), "", 0, TDEFL_FINISH);
     if (done != TDEFL_STATUS_DONE && done != TDEFL_STATUS_OKAY) {
       // Cannot flush compressed buffer
@@ -483,6 +591,7 @@ cleanup:
   if (zip) {
     zip->entry.m_time = 0;
     CLEANUP(zip->entry.name);
+    CLEANUP(zip->entry.stream);
   }
   return status;
 }
@@ -538,6 +647,11 @@ int zip_entry_write(struct zip_t *zip, const void *buf, size_t bufsize) {
     return -1;
   }
 
+  if (zip->entry.deflated) {
+    // the entry is written with zip_entry_write_deflated
+    return -1;
+  }
+
   pzip = &(zip->archive);
   if (buf && bufsize > 0) {
     zip->entry.uncomp_size += bufsize;
@@ -566,6 +680,104 @@ int zip_entry_write(struct zip_t *zip, const void *buf, size_t bufsize) {
   return 0;
 }
 
+static mz_uint32 gf2_matrix_times(const mz_uint32 *mat, mz_uint32 vec) {
+  mz_uint32 sum = 0;
+  while (vec) {
+    if (vec & 1)
+      sum ^= *mat;
+    vec >>= 1;
+    mat++;
+  }
+  return sum;
+}
+
+static void gf2_matrix_square(mz_uint32 *square, const mz_uint32 *mat) {
+  int n;
+  for (n = 0; n < 32; n++)
+    square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+// crc-32 of two concatenated blocks, given the crc-32 of each block
+// (same algorithm as zlib's crc32_combine)
+static mz_uint32 crc32_combine(mz_uint32 crc1, mz_uint32 crc2,
+                               mz_uint64 len2) {
+  int n;
+  mz_uint32 row;
+  mz_uint32 even[32]; // even-power-of-two zeros operator
+  mz_uint32 odd[32];  // odd-power-of-two zeros operator
+
+  if (len2 == 0)
+    return crc1;
+
+  // put operator for one zero bit in odd
+  odd[0] = 0xedb88320UL; // CRC-32 polynomial
+  row = 1;
+  for (n = 1; n < 32; n++) {
+    odd[n] = row;
+    row <<= 1;
+  }
+
+  gf2_matrix_square(even, odd); // two zero bits
+  gf2_matrix_square(odd, even); // four zero bits
+
+  // apply len2 zeros to crc1 (first square will put the operator for one
+  // zero byte, eight zero bits, in even)
+  do {
+    gf2_matrix_square(even, odd);
+    if (len2 & 1)
+      crc1 = gf2_matrix_times(even, crc1);
+    len2 >>= 1;
+    if (len2 == 0)
+      break;
+
+    gf2_matrix_square(odd, even);
+    if (len2 & 1)
+      crc1 = gf2_matrix_times(odd, crc1);
+    len2 >>= 1;
+  } while (len2 != 0);
+
+  return crc1 ^ crc2;
+}
+
+int zip_entry_write_deflated(struct zip_t *zip, const void *buf,
+                             size_t bufsize, unsigned long long uncomp_size,
+                             unsigned int uncomp_crc32) {
+  mz_zip_archive *pzip = NULL;
+
+  if (!zip) {
+    // zip_t handler is not initialized
+    return -1;
+  }
+
+  pzip = &(zip->archive);
+  if (pzip->m_zip_mode != MZ_ZIP_MODE_WRITING || !zip->entry.name) {
+    // Wrong zip mode or no entry is opened
+    return -1;
+  }
+
+  if (!zip->entry.deflated && zip->entry.uncomp_size > 0) {
+    // the entry is written with zip_entry_write
+    return -1;
+  }
+  zip->entry.deflated = 1;
+
+  if (buf && bufsize > 0) {
+    if (pzip->m_pWrite(pzip->m_pIO_opaque, zip->entry.offset, buf, bufsize) !=
+        bufsize) {
+      // Cannot write buffer
+      return -1;
+    }
+    zip->entry.offset += bufsize;
+    zip->entry.comp_size += bufsize;
+  }
+
+  zip->entry.uncomp_crc32 =
+      crc32_combine(zip->entry.uncomp_crc32, uncomp_crc32, uncomp_size);
+  zip->entry.uncomp_size += uncomp_size;
+
+  return 0;
+}
+
 int zip_entry_fwrite(struct zip_t *zip, const char *filename) {
   int status = 0;
   size_t n = 0;
@@ -665,6 +877,184 @@ ssize_t zip_entry_noallocread(struct zip_t *zip, void *buf, size_t bufsize) {
   return (ssize_t)zip->entry.uncomp_size;
 }
 
+// Sets up zip_entry_readchunk for the current entry
+static struct zip_entry_stream_t *zip_entry_stream_open(struct zip_t *zip) {
+  mz_zip_archive *pzip = &(zip->archive);
+  struct zip_entry_stream_t *stream = NULL;
+  mz_uint32 header_u32[(MZ_ZIP_LOCAL_DIR_HEADER_SIZE + sizeof(mz_uint32) - 1) /
+                       sizeof(mz_uint32)];
+  mz_uint8 *header = (mz_uint8 *)header_u32;
+
+  if (zip->entry.method != 0 && zip->entry.method != MZ_DEFLATED) {
+    // Unsupported compression method
+    return NULL;
+  }
+
+  // The data follows the local header, whose name and extra field may
+  // differ from the central directory
+  if (pzip->m_pRead(pzip->m_pIO_opaque, zip->entry.header_offset, header,
+                    MZ_ZIP_LOCAL_DIR_HEADER_SIZE) !=
+          MZ_ZIP_LOCAL_DIR_HEADER_SIZE ||
+      MZ_READ_LE32(header) != MZ_ZIP_LOCAL_DIR_HEADER_SIG) {
+    return NULL;
+  }
+
+  stream = (struct zip_entry_stream_t *)calloc(
+      (size_t)1, sizeof(struct zip_entry_stream_t));
+  if (!stream) {
+    return NULL;
+  }
+
+  tinfl_init(&(stream->inflator));
+  stream->comp_ofs = zip->entry.header_offset + MZ_ZIP_LOCAL_DIR_HEADER_SIZE +
+                     MZ_READ_LE16(header + MZ_ZIP_LDH_FILENAME_LEN_OFS) +
+                     MZ_READ_LE16(header + MZ_ZIP_LDH_EXTRA_LEN_OFS);
+  stream->comp_left = zip->entry.comp_size;
+  stream->crc32 = MZ_CRC32_INIT;
+  return stream;
+}
+
+ssize_t zip_entry_readchunk(struct zip_t *zip, void *buf, size_t bufsize) {
+  mz_zip_archive *pzip = NULL;
+  struct zip_entry_stream_t *stream = NULL;
+  mz_uint8 *out = (mz_uint8 *)buf;
+  size_t total = 0, n, in_size, out_size;
+  tinfl_status status;
+
+  if (!zip || (!buf && bufsize)) {
+    // zip_t handler is not initialized
+    return -1;
+  }
+
+  pzip = &(zip->archive);
+  if (pzip->m_zip_mode != MZ_ZIP_MODE_READING || zip->entry.index < 0) {
+    // the entry is not found or we do not have read access
+    return -1;
+  }
+
+  if (!zip->entry.stream) {
+    zip->entry.stream = zip_entry_stream_open(zip);
+    if (!zip->entry.stream) {
+      return -1;
+    }
+  }
+  stream = zip->entry.stream;
+
+  while (total < bufsize) {
+    if (stream->out_avail) {
+      n = MZ_MIN(stream->out_avail, bufsize - total);
+      memcpy(out + total, stream->dict + stream->out_ofs, n);
+      stream->out_ofs += n;
+      stream->out_avail -= n;
+      total += n;
+      continue;
+    }
+    if (stream->done) {
+      break;
+    }
+
+    if (zip->entry.method == 0) {
+      // Stored entries are read as they are
+      n = (size_t)MZ_MIN(stream->comp_left, (mz_uint64)(bufsize - total));
+      if (pzip->m_pRead(pzip->m_pIO_opaque, stream->comp_ofs, out + total,
+                        n) != n) {
+        return -1;
+      }
+      stream->crc32 = (mz_uint32)mz_crc32(stream->crc32, out + total, n);
+      stream->comp_ofs += n;
+      stream->comp_left -= n;
+      total += n;
+      stream->done = stream->comp_left == 0;
+    } else {
+      if (!stream->in_avail && stream->comp_left) {
+        n = (size_t)MZ_MIN(stream->comp_left, (mz_uint64)sizeof(stream->in));
+        if (pzip->m_pRead(pzip->m_pIO_opaque, stream->comp_ofs, stream->in,
+                          n) != n) {
+          return -1;
+        }
+        stream->comp_ofs += n;
+        stream->comp_left -= n;
+        stream->in_ofs = 0;
+        stream->in_avail = n;
+      }
+
+      in_size = stream->in_avail;
+      out_size = TINFL_LZ_DICT_SIZE - stream->dict_ofs;
+      status = tinfl_decompress(
+          &(stream->inflator), stream->in + stream->in_ofs, &in_size,
+          stream->dict, stream->dict + stream->dict_ofs, &out_size,
+          stream->comp_left ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+      stream->in_ofs += in_size;
+      stream->in_avail -= in_size;
+
+      stream->crc32 = (mz_uint32)mz_crc32(
+          stream->crc32, stream->dict + stream->dict_ofs, out_size);
+      stream->out_ofs = stream->dict_ofs;
+      stream->out_avail = out_size;
+      stream->dict_ofs = (stream->dict_ofs + out_size) & (TINFL_LZ_DICT_SIZE - 1);
+
+      if (status == TINFL_STATUS_DONE) {
+        stream->done = 1;
+      } else if (status < TINFL_STATUS_DONE ||
+                 (status == TINFL_STATUS_NEEDS_MORE_INPUT &&
+                  !stream->comp_left && !stream->in_avail)) {
+        // Corrupt or truncated data
+        return -1;
+      }
+    }
+
+    if (stream->done && stream->crc32 != zip->entry.uncomp_crc32) {
+      // The entry is corrupt
+      return -1;
+    }
+  }
+
+  return (ssize_t)total;
+}
+
+ssize_t zip_entry_data(struct zip_t *zip, const void **data) {
+  mz_zip_archive *pzip = NULL;
+  const mz_uint8 *pMem = NULL;
+  mz_uint64 ofs;
+
+  if (!zip || !data) {
+    // zip_t handler is not initialized
+    return -1;
+  }
+
+  pzip = &(zip->archive);
+  if (pzip->m_zip_mode != MZ_ZIP_MODE_READING || zip->entry.index < 0 ||
+      !pzip->m_pState->m_pMem) {
+    // the entry is not found or the archive is not in memory
+    return -1;
+  }
+
+  if (zip->entry.method != 0 || zip->entry.comp_size != zip->entry.uncomp_size) {
+    // the entry is compressed
+    return -1;
+  }
+
+  ofs = zip->entry.header_offset;
+  if (ofs + MZ_ZIP_LOCAL_DIR_HEADER_SIZE > pzip->m_archive_size) {
+    return -1;
+  }
+
+  pMem = (const mz_uint8 *)pzip->m_pState->m_pMem;
+  if (MZ_READ_LE32(pMem + ofs) != MZ_ZIP_LOCAL_DIR_HEADER_SIG) {
+    return -1;
+  }
+
+  ofs += MZ_ZIP_LOCAL_DIR_HEADER_SIZE +
+         MZ_READ_LE16(pMem + ofs + MZ_ZIP_LDH_FILENAME_LEN_OFS) +
+         MZ_READ_LE16(pMem + ofs + MZ_ZIP_LDH_EXTRA_LEN_OFS);
+  if (ofs + zip->entry.uncomp_size > pzip->m_archive_size) {
+    return -1;
+  }
+
+  *data = pMem + ofs;
+  return (ssize_t)zip->entry.uncomp_size;
+}
+
 int zip_entry_fread(struct zip_t *zip, const char *filename) {
   mz_zip_archive *pzip = NULL;
   mz_uint idx;
@@ -735,6 +1125,79 @@ int zip_entry_extract(struct zip_t *zip,
              : -1;
 }
 
+int zip_entry_copy(struct zip_t *zip, struct zip_t *src, int index) {
+  if (!zip || !src) {
+    // zip_t handler is not initialized
+    return -1;
+  }
+
+  if (src->archive.m_zip_mode != MZ_ZIP_MODE_READING || index < 0 ||
+      (mz_uint)index >= src->archive.m_total_files) {
+    // the entry is not found or we do not have read access
+    return -1;
+  }
+
+  return (mz_zip_writer_add_from_zip_reader(&(zip->archive), &(src->archive),
+                                            (mz_uint)index))
+             ? 0
+             : -1;
+}
+
+int zip_entry_drop(struct zip_t *zip, const char *entryname) {
+  mz_zip_archive *pzip = NULL;
+  mz_zip_internal_state *pState = NULL;
+  mz_uint i, index, namelen, reclen;
+  mz_uint32 ofs;
+  const mz_uint8 *header;
+
+  if (!zip || !entryname) {
+    // zip_t handler is not initialized
+    return -1;
+  }
+
+  pzip = &(zip->archive);
+  pState = pzip->m_pState;
+  if (!pState || pzip->m_zip_mode != MZ_ZIP_MODE_WRITING) {
+    // Wrong zip mode
+    return -1;
+  }
+
+  namelen = (mz_uint)strlen(entryname);
+  for (index = 0; index < pzip->m_total_files; index++) {
+    ofs = MZ_ZIP_ARRAY_ELEMENT(&pState->m_central_dir_offsets, mz_uint32,
+                               index);
+    header = &MZ_ZIP_ARRAY_ELEMENT(&pState->m_central_dir, mz_uint8, ofs);
+    if (MZ_READ_LE16(header + MZ_ZIP_CDH_FILENAME_LEN_OFS) == namelen &&
+        !memcmp(header + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE, entryname, namelen))
+      break;
+  }
+  if (index == pzip->m_total_files) {
+    // the entry is not found
+    return -1;
+  }
+
+  reclen = MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + namelen +
+           MZ_READ_LE16(header + MZ_ZIP_CDH_EXTRA_LEN_OFS) +
+           MZ_READ_LE16(header + MZ_ZIP_CDH_COMMENT_LEN_OFS);
+
+  // Close the gap in the central directory and shift the offsets of the
+  // records which follow
+  memmove(&MZ_ZIP_ARRAY_ELEMENT(&pState->m_central_dir, mz_uint8, ofs),
+          &MZ_ZIP_ARRAY_ELEMENT(&pState->m_central_dir, mz_uint8, ofs + reclen),
+          pState->m_central_dir.m_size - ofs - reclen);
+  pState->m_central_dir.m_size -= reclen;
+
+  for (i = index; i + 1 < pzip->m_total_files; i++)
+    MZ_ZIP_ARRAY_ELEMENT(&pState->m_central_dir_offsets, mz_uint32, i) =
+        MZ_ZIP_ARRAY_ELEMENT(&pState->m_central_dir_offsets, mz_uint32,
+                             i + 1) -
+        reclen;
+  pState->m_central_dir_offsets.m_size--;
+  pzip->m_total_files--;
+
+  return 0;
+}
+
 int zip_total_entries(struct zip_t *zip) {
   if (!zip) {
     // zip_t handler is not initialized
@@ -744,6 +1207,98 @@ int zip_total_entries(struct zip_t *zip) {
   return (int)zip->archive.m_total_files;
 }
 
+struct zip_t *zip_stream_open(const char *stream, size_t size, int level,
+                              char mode) {
+  struct zip_t *zip = NULL;
+
+  if (level < 0)
+    level = MZ_DEFAULT_LEVEL;
+  if ((level & 0xF) > MZ_UBER_COMPRESSION) {
+    // Wrong compression level
+    goto cleanup;
+  }
+
+  zip = (struct zip_t *)calloc((size_t)1, sizeof(struct zip_t));
+  if (!zip)
+    goto cleanup;
+
+  zip->level = (mz_uint)level;
+  if (mode != 'r') {
+    // Archives are written through zip_writer_open
+    goto cleanup;
+  }
+  if (!stream || !size) {
+    // zip_t archive stream is empty or NULL
+    goto cleanup;
+  }
+  if (!mz_zip_reader_init_mem(
+          &(zip->archive), stream, size,
+          zip->level | MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY)) {
+    // Cannot initialize zip_archive reader
+    goto cleanup;
+  }
+
+  return zip;
+
+cleanup:
+  CLEANUP(zip);
+  return NULL;
+}
+
+struct zip_t *
+zip_writer_open(int level,
+                size_t (*on_write)(void *arg, unsigned long long offset,
+                                   const void *data, size_t size),
+                void *arg) {
+  struct zip_t *zip = NULL;
+
+  if (!on_write) {
+    goto cleanup;
+  }
+
+  if (level < 0)
+    level = MZ_DEFAULT_LEVEL;
+  if ((level & 0xF) > MZ_UBER_COMPRESSION) {
+    // Wrong compression level
+    goto cleanup;
+  }
+
+  zip = (struct zip_t *)calloc((size_t)1, sizeof(struct zip_t));
+  if (!zip)
+    goto cleanup;
+
+  zip->level = (mz_uint)level;
+  zip->archive.m_pWrite = on_write;
+  zip->archive.m_pIO_opaque = arg;
+  if (!mz_zip_writer_init(&(zip->archive), 0)) {
+    // Cannot initialize zip_archive writer
+    goto cleanup;
+  }
+
+  return zip;
+
+cleanup:
+  CLEANUP(zip);
+  return NULL;
+}
+
+int zip_stream_reopen(struct zip_t *zip, const char *stream, size_t size) {
+  if (zip_reader_clear(zip) < 0) {
+    return -1;
+  }
+  if (!stream || !size) {
+    // zip_t archive stream is empty or NULL
+    return -1;
+  }
+
+  zip->archive.m_pRead = mz_zip_mem_read_func;
+  zip->archive.m_pIO_opaque = &(zip->archive);
+  zip->archive.m_pState->m_pMem = (void *)stream;
+  zip->archive.m_pState->m_mem_size = size;
+  zip->archive.m_archive_size = size;
+  return zip_reader_load(zip);
+}
+
 int zip_create(const char *zipname, const char *filenames[], size_t len) {
   int status = 0;
   size_t i;
@@ -67,6 +67,23 @@ extern struct zip_t *zip_open(const char *zipname, int level, char mode);
 */
 extern void zip_close(struct zip_t *zip);
 
+/*
+  Points a zip archive opened for reading at another file. The central
+  directory arrays of the handler are reused, so reading a series of
+  archives allocates only when one has a bigger central directory than
+  the archives before it.
+
+  Args:
+    zip: zip archive handler opened in 'r' mode or with zip_stream_open.
+    zipname: zip archive file name, or NULL to release the file or memory
+             being read and leave the archive empty.
+
+  Returns:
+    The return code - 0 on success, negative number (< 0) on error.
+    On error the archive is left empty.
+*/
+extern int zip_reopen(struct zip_t *zip, const char *zipname);
+
 /*
   Opens an entry by name in the zip archive.
   For zip archive opened in 'w' or 'a' mode the function will append
@@ -180,6 +197,27 @@ extern unsigned int zip_entry_crc32(struct zip_t *zip);
 */
 extern int zip_entry_write(struct zip_t *zip, const void *buf, size_t bufsize);
 
+/*
+  Appends already deflated data to the current zip entry.
+  The blocks written to one entry must form a single raw deflate stream
+  (without zlib header), ended by a final block. This function can't be
+  mixed with zip_entry_write on the same entry.
+
+  Args:
+    zip: zip archive handler.
+    buf: deflated data.
+    bufsize: size of the deflated data (in bytes).
+    uncomp_size: number of bytes the data inflates to.
+    uncomp_crc32: crc-32 of the bytes the data inflates to.
+
+  Returns:
+    The return code - 0 on success, negative number (< 0) on error.
+*/
+extern int zip_entry_write_deflated(struct zip_t *zip, const void *buf,
+                                    size_t bufsize,
+                                    unsigned long long uncomp_size,
+                                    unsigned int uncomp_crc32);
+
 /*
   Compresses a file for the current zip entry.
 
@@ -232,6 +270,41 @@ extern ssize_t zip_entry_read(struct zip_t *zip, void **buf, size_t *bufsize);
 */
 extern ssize_t zip_entry_noallocread(struct zip_t *zip, void *buf, size_t bufsize);
 
+/*
+  Reads the next piece of the current zip entry, inflating only as much as
+  needed to fill the buffer. The memory used does not depend on the size of
+  the entry: the entry is read in blocks of 64 KiB and inflated through a
+  32 KiB window.
+
+  Args:
+    zip: zip archive handler opened for reading.
+    buf: output buffer.
+    bufsize: output buffer size (in bytes).
+
+  Returns:
+    The return code - the number of bytes read, 0 once the whole entry has
+    been read, or a negative number (< 0) on error (e.g. corrupt data or a
+    crc-32 mismatch).
+*/
+extern ssize_t zip_entry_readchunk(struct zip_t *zip, void *buf,
+                                   size_t bufsize);
+
+/*
+  Gives direct access to the data of the current zip entry, without copying.
+  This is only possible for stored (uncompressed) entries of an archive
+  opened with zip_stream_open; the pointer stays valid as long as the
+  stream does.
+
+  Args:
+    zip: zip archive handler.
+    data: output pointer to the first byte of the entry data.
+
+  Returns:
+    The return code - the size of the entry data on success.
+    Otherwise a -1 on error (e.g. the entry is compressed).
+*/
+extern ssize_t zip_entry_data(struct zip_t *zip, const void **data);
+
 /*
   Extracts the current zip entry into output file.
 
@@ -262,6 +335,36 @@ zip_entry_extract(struct zip_t *zip,
                                        const void *data, size_t size),
                   void *arg);
 
+/*
+  Copies an entry from another zip archive without recompressing it.
+  The local header, compressed data and crc-32 of the source entry are
+  written as is, so the cost depends only on the compressed size.
+
+  Args:
+    zip: zip archive handler opened in 'w' or 'a' mode.
+    src: zip archive handler opened in 'r' mode.
+    index: index of the entry in the source archive.
+
+  Returns:
+    The return code - 0 on success, negative number (< 0) on error.
+*/
+extern int zip_entry_copy(struct zip_t *zip, struct zip_t *src, int index);
+
+/*
+  Removes an entry from the central directory of an archive opened in 'a'
+  mode. The local header and data of the entry stay in the file, but are no
+  longer part of the archive once it is closed, so an entry can be replaced
+  by appending a new one with the same name.
+
+  Args:
+    zip: zip archive handler opened in 'a' mode.
+    entryname: an entry name in local dictionary.
+
+  Returns:
+    The return code - 0 on success, negative number (< 0) on error.
+*/
+extern int zip_entry_drop(struct zip_t *zip, const char *entryname);
+
 /*
   Returns the number of all entries (files and directories) in the zip archive.
 
@@ -274,6 +377,60 @@ zip_entry_extract(struct zip_t *zip,
 */
 extern int zip_total_entries(struct zip_t *zip);
 
+/*
+  Opens zip archive stream into memory.
+
+  Args:
+    stream: zip archive stream.
+    size: the size of the stream.
+    level: compression level (0-9 are the standard zlib-style levels).
+    mode: file access mode.
+        'r': opens the in-memory archive for reading/extracting.
+        Archives are written with zip_writer_open.
+
+  Returns:
+    The zip archive handler or NULL on error
+*/
+extern struct zip_t *zip_stream_open(const char *stream, size_t size,
+                                     int level, char mode);
+
+/*
+  Points a zip archive opened for reading at another in-memory archive,
+  reusing its allocations like zip_reopen does.
+
+  Args:
+    zip: zip archive handler opened in 'r' mode or with zip_stream_open.
+    stream: zip archive stream.
+    size: the size of the stream.
+
+  Returns:
+    The return code - 0 on success, negative number (< 0) on error.
+    On error the archive is left empty.
+*/
+extern int zip_stream_reopen(struct zip_t *zip, const char *stream,
+                             size_t size);
+
+/*
+  Opens zip archive for writing through a callback function (on_write).
+  The callback receives the offset of every block it is given; the local
+  header of an entry is written again at its original offset when the
+  entry is closed, so the output must support random access.
+
+  Args:
+    level: compression level (0-9 are the standard zlib-style levels).
+    on_write: callback function, must return the number of bytes written.
+    arg: opaque pointer (optional argument,
+                         which you can pass to the on_write callback)
+
+  Returns:
+    The zip archive handler or NULL on error
+*/
+extern struct zip_t *
+zip_writer_open(int level,
+                size_t (*on_write)(void *arg, unsigned long long offset,
+                                   const void *data, size_t size),
+                void *arg);
+
 /*
   Creates a new archive and puts files into a single zip archive.
 